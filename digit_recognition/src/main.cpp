@@ -1,6 +1,7 @@
 #include "neural_net.h"
 #include "read_mnist.h"
 
+#include <cstdio>
 #include <iostream>
 
 #if defined(_WIN32) || defined(_WIN64)
@@ -67,7 +68,15 @@ int main(int argc, const char* argv[]) {
     hy.mu                     = 0.0234375f;
     hy.no_improvement_in      = 10;
     hy.stop_eta_fraction      = 128;
-    NeuralNet::sgd(net, hy);
+    // throughput and accuracy of each epoch
+    hy.metrics_path = "metrics.jsonl";
+    // continue from last checkpoint after a crash
+    hy.checkpoint_path    = "checkpoint.bin";
+    hy.checkpoint_seconds = 60.0f;
+    NeuralNet::TrainingState state(net, hy);
+    NeuralNet::load_checkpoint(net, hy, state, hy.checkpoint_path);
+    NeuralNet::sgd(net, hy, state);
+    std::remove(hy.checkpoint_path.c_str());
 
     print_img(test_data.get_mini_x(50, 1));
     std::cout << NeuralNet::feedforward(net, test_data.get_mini_x(50, 1)) << std::endl;
@@ -0,0 +1,94 @@
+#include "neural_net.h"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+// random football shaped data
+// input: three relative guesses, output: home and guest goals
+NeuralNet::Data random_data(size_t n) {
+    arma::fmat raw(3 + 12, n, arma::fill::zeros);
+    raw.rows(0, 2).randu();
+    for(size_t i = 0; i < n; ++i) {
+        raw(3 + std::rand() % 6, i)     = 1.0f;
+        raw(3 + 6 + std::rand() % 6, i) = 1.0f;
+    }
+    return {raw, 3, 12};
+}
+
+template<typename Func>
+long long time_ns(Func func) {
+    auto begin = std::chrono::high_resolution_clock::now();
+    func();
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+}
+
+int main(int argc, char* argv[]) {
+    NeuralNet::init();
+    NeuralNet::Log::set_client_level(NeuralNet::LogLevel::Extra);
+    NeuralNet::Log::set_learn_level(NeuralNet::LogLevel::Warn);
+
+    size_t n      = argc > 1 ? std::stoul(argv[1]) : 10000;
+    size_t epochs = argc > 2 ? std::stoul(argv[2]) : 5;
+
+    NeuralNet::Data data = random_data(n);
+
+    NeuralNet::Network net;
+    create_network(net, {3, 100, 100, 12});
+    NeuralNet::FixedNetwork<3, 100, 100, 12> fixed;
+    NeuralNet::from_network(fixed, net);
+
+    ///////////////
+    // inference //
+    ///////////////
+    // keep results alive
+    float     checksum   = 0.0f;
+    long long dynamic_ns = time_ns([&]() {
+        for(size_t i = 0; i < n; ++i) {
+            arma::fvec a = NeuralNet::feedforward(net, data.get_mini_x(i, 1));
+            checksum += a(0);
+        }
+    });
+    long long fixed_ns = time_ns([&]() {
+        for(size_t i = 0; i < n; ++i) {
+            arma::fvec a = NeuralNet::feedforward(fixed, data.get_x_ptr(i));
+            checksum += a(0);
+        }
+    });
+    // compare results
+    float max_diff = 0.0f;
+    for(size_t i = 0; i < n; ++i) {
+        arma::fvec dynamic_a = NeuralNet::feedforward(net, data.get_mini_x(i, 1));
+        arma::fvec fixed_a   = NeuralNet::feedforward(fixed, data.get_x_ptr(i));
+        arma::fvec diff      = arma::abs(dynamic_a - fixed_a);
+        max_diff             = std::max(max_diff, diff.max());
+    }
+    log_client_extra("checksum: {}", checksum);
+    log_client_general("inference of {} data sets:", n);
+    log_client_general("\tdynamic: {} ns per data set", dynamic_ns / n);
+    log_client_general("\tfixed: {} ns per data set", fixed_ns / n);
+    log_client_general("\tspeedup: {}; max output difference: {}", static_cast<float>(dynamic_ns) / fixed_ns, max_diff);
+
+    //////////////
+    // training //
+    //////////////
+    NeuralNet::HyperParameter hy;
+    hy.training_data   = &data;
+    hy.init_eta        = 0.5f;
+    hy.mu              = 0.2f;
+    hy.lambda_l2       = 0.1f;
+    hy.mini_batch_size = 30;
+    hy.max_epochs      = epochs - 1;
+
+    NeuralNet::sgd(net, hy);
+    long long dynamic_learn_time = hy.learn_time;
+    NeuralNet::sgd(fixed, hy);
+    long long fixed_learn_time = hy.learn_time;
+
+    log_client_general("training {} epochs with mini batch size {}:", epochs, hy.mini_batch_size);
+    log_client_general("\tdynamic: {} ms per epoch", dynamic_learn_time / 1e6f / epochs);
+    log_client_general("\tfixed: {} ms per epoch", fixed_learn_time / 1e6f / epochs);
+    log_client_general("\tspeedup: {}", static_cast<float>(dynamic_learn_time) / fixed_learn_time);
+    return 0;
+}
@@ -1,5 +1,6 @@
 #include "neural_net.h"
 
+#include <cstdio>
 #include <iostream>
 #include <string>
 
@@ -88,7 +89,10 @@ NeuralNet::Data load_data(const std::string& matches_path) {
 }
 
 int main(int argc, char* argv[]) {
-    NeuralNet::init();
+    // hyper surfing logs a lot from many threads
+    NeuralNet::LogConfig log_config;
+    log_config.async = true;
+    NeuralNet::init(log_config);
     NeuralNet::Log::set_client_level(NeuralNet::LogLevel::Extra);
     if(argc < 2)
         raise_critical("Please specify the path to the data as the first parameter.");
@@ -176,11 +180,14 @@ int main(int argc, char* argv[]) {
     hy.training_data = &train_data;
     hy.test_data     = &test_data;
     hy.eval_data     = &test_data;
+    // rerunning the surf reuses finished probes
+    NeuralNet::TrialCache trial_cache("trial_cache.json");
+    hy.trial_cache = &trial_cache;
 
     // coarse
     NeuralNet::Log::set_hyper_level(NeuralNet::LogLevel::General);
     NeuralNet::Log::set_learn_level(NeuralNet::LogLevel::Warn);
-    NeuralNet::coarse_hyper_surf(net, hy);
+    NeuralNet::coarse_hyper_surf(net, hy, "throughput.json");
 
     // fine
     hy.max_epochs             = 100;
@@ -213,8 +220,16 @@ int main(int argc, char* argv[]) {
     //     hy.mu              = 0.998901f;
     //     hy.lambda_l2       = 0.000268912f;
 
-    NeuralNet::sgd(net, hy);
+    // throughput and accuracy of each epoch
+    hy.metrics_path = "metrics.jsonl";
+    // continue from last checkpoint after a crash
+    hy.checkpoint_path    = "checkpoint.bin";
+    hy.checkpoint_seconds = 60.0f;
+    NeuralNet::TrainingState state(net, hy);
+    NeuralNet::load_checkpoint(net, hy, state, hy.checkpoint_path);
+    NeuralNet::sgd(net, hy, state);
     NeuralNet::save_json(net, "net.json");
+    std::remove(hy.checkpoint_path.c_str());
 
     // NeuralNet::load_json_network(net, "net1.json");
 
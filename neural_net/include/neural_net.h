@@ -1,16 +1,31 @@
 #pragma once
 #include "hyper/data.h"
 #include "hyper/hyper_surfer.h"
+#include "hyper/synthetic.h"
+#include "hyper/throughput.h"
+#include "hyper/trial_cache.h"
+#include "learn/checkpoint.h"
+#include "learn/distributed.h"
 #include "learn/eval.h"
 #include "learn/evaluator.h"
+#include "learn/fixed_learn.h"
 #include "learn/learn.h"
+#include "learn/lockstep.h"
 #include "main/log.h"
+#include "main/memory.h"
+#include "main/profiler.h"
+#include "main/threading.h"
 #include "net/costs.h"
+#include "net/fixed_net.h"
+#include "net/low_rank.h"
 #include "net/net.h"
+#include "net/pruning.h"
 #include "net/setup.h"
+#include "net/sparse_net.h"
 
 namespace NeuralNet {
-inline void init() {
-    Log::init();
+inline void init(const LogConfig& log_config = {}, const ThreadingPolicy& threading_policy = {}) {
+    Log::init(log_config);
+    Threading::init(threading_policy);
 }
 } // namespace NeuralNet
@@ -1,8 +1,12 @@
 #pragma once
 #include "main/log.h"
 
+#include <algorithm>
 #include <armadillo>
+#include <numeric>
+#include <random>
 #include <stddef.h>
+#include <utility>
 
 namespace NeuralNet {
 class Data {
@@ -18,7 +22,7 @@ public:
         : m_data(x_size + y_size, n_cols, arma::fill::zeros), m_x_size(x_size), m_y_size(y_size) {}
 
     Data(arma::fmat data, size_t x_size, size_t y_size)
-        : m_data(data), m_x_size(x_size), m_y_size(y_size) {}
+        : m_data(std::move(data)), m_x_size(x_size), m_y_size(y_size) {}
 
     // input
     const arma::subview<float> get_x() const { return m_data.rows(0, m_x_size - 1); }
@@ -44,11 +48,23 @@ public:
         return m_data.submat(m_x_size, offset, m_x_size + m_y_size - 1, offset + length - 1);
     }
 
+    // raw column access; input followed by desired output
+    // no bounds checking
+    const float* get_x_ptr(size_t idx) const { return m_data.colptr(idx); }
+    const float* get_y_ptr(size_t idx) const { return m_data.colptr(idx) + m_x_size; }
+
     Data get_shuffled() const {
         // todo: better random
         arma::arma_rng::set_seed_random();
         return {arma::shuffle(m_data, 1), m_x_size, m_y_size};
     }
+    // reproducible with state of rng
+    Data get_shuffled(std::mt19937& rng) const {
+        std::vector<arma::uword> order(m_data.n_cols);
+        std::iota(order.begin(), order.end(), 0);
+        std::shuffle(order.begin(), order.end(), rng);
+        return {m_data.cols(arma::uvec(order)), m_x_size, m_y_size};
+    }
     void shuffle() {
         // todo: better random
         arma::arma_rng::set_seed_random();
@@ -69,6 +85,16 @@ public:
             raise_critical("Requested sub data is invlaid.");
         return {m_data.cols(offset, offset + length - 1), m_x_size, m_y_size};
     }
+    // every n_shards-th data set starting at rank
+    // all shards have the same size <- up to n_shards - 1 data sets get dropped
+    Data get_shard(size_t rank, size_t n_shards) const {
+        if(rank >= n_shards)
+            raise_critical("Requested shard {} of {} is invalid.", rank, n_shards);
+        std::vector<arma::uword> columns(m_data.n_cols / n_shards);
+        for(size_t idx = 0; idx < columns.size(); ++idx)
+            columns[idx] = idx * n_shards + rank;
+        return {m_data.cols(arma::uvec(columns)), m_x_size, m_y_size};
+    }
     void sub(size_t offset, size_t length) {
         if(offset + length > m_data.n_cols)
             raise_critical("Requested sub data is invlaid.");
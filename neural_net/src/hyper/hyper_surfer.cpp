@@ -1,35 +1,140 @@
 #include "hyper_surfer.h"
 
+#include "hyper/trial_cache.h"
+#include "learn/eval.h"
 #include "learn/learn.h"
+#include "learn/lockstep.h"
 #include "net/setup.h"
 #include "pch.h"
 
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <random>
+
 namespace NeuralNet {
-inline void test(const Network& net, HyperParameter& hy) {
-    Network current_net = net;
+// repetition tells runs of the same configuration apart in the trial cache, see TrialCache
+inline void test(const Network& net, HyperParameter& hy, size_t repetition = 0) {
     hy.reset_results();
+    if(hy.trial_cache && hy.trial_cache->load(net, hy, repetition))
+        return;
+    Network current_net = net;
     sgd(current_net, hy);
+    if(hy.trial_cache)
+        hy.trial_cache->store(net, hy, repetition);
+}
+
+// train first fork_epochs epochs shared by all probes of a fork
+inline std::unique_ptr<TrainingState> fork_base(Network& net, HyperParameter& hy, size_t fork_epochs) {
+    if(fork_epochs > hy.max_epochs)
+        raise_critical("fork_epochs has to be at most max_epochs.");
+    size_t max_epochs_buffer = hy.max_epochs;
+    hy.reset_results();
+    // sgd runs max_epochs + 1 epochs
+    hy.max_epochs = fork_epochs - 1;
+    std::unique_ptr<TrainingState> state = std::make_unique<TrainingState>(net, hy);
+    sgd(net, hy, *state);
+    hy.max_epochs = max_epochs_buffer;
+    return state;
+}
+
+// continue base run with hyper parameters of hy
+// results of base run stay in front of results of hy
+inline void fork_test(const Network& base_net, const TrainingState& base_state, const HyperParameter& base_hy, HyperParameter& hy) {
+    hy.test_costs       = base_hy.test_costs;
+    hy.test_accuracies  = base_hy.test_accuracies;
+    hy.eval_costs       = base_hy.eval_costs;
+    hy.eval_accuracies  = base_hy.eval_accuracies;
+    hy.train_costs      = base_hy.train_costs;
+    hy.train_accuracies = base_hy.train_accuracies;
+    hy.epochs_to_target = base_hy.epochs_to_target;
+    hy.time_to_target   = base_hy.time_to_target;
+
+    Network       current_net = base_net;
+    TrainingState state       = base_state;
+    // probes may change init_eta
+    state.eta = hy.init_eta;
+    sgd(current_net, hy, state);
+}
+
+// train copies of nets in lockstep; hys[i] gets results of nets[i]
+// only networks missing in the trial cache get trained
+inline void test_lockstep(const std::vector<Network>& nets, std::vector<HyperParameter>& hys, const std::vector<size_t>& repetitions) {
+    std::vector<Network>        missing_nets;
+    std::vector<HyperParameter> missing_hys;
+    std::vector<size_t>         missing_idxs;
+    for(size_t i = 0; i < nets.size(); ++i) {
+        hys[i].reset_results();
+        if(hys[i].trial_cache && hys[i].trial_cache->load(nets[i], hys[i], repetitions[i]))
+            continue;
+        missing_nets.push_back(nets[i]);
+        missing_hys.push_back(hys[i]);
+        missing_idxs.push_back(i);
+    }
+    if(missing_nets.empty())
+        return;
+    lockstep_sgd(missing_nets, missing_hys);
+    for(size_t j = 0; j < missing_idxs.size(); ++j) {
+        size_t i = missing_idxs[j];
+        hys[i]   = missing_hys[j];
+        if(hys[i].trial_cache)
+            hys[i].trial_cache->store(nets[i], hys[i], repetitions[i]);
+    }
+}
+
+// train amount networks with different sets of weights
+// return copies of hy with results of each network; hy keeps results of last one
+inline std::vector<HyperParameter> test_repetitions(Network net, HyperParameter& hy, size_t amount) {
+    std::vector<size_t> repetitions(amount);
+    std::iota(repetitions.begin(), repetitions.end(), 0);
+    if(hy.lockstep_trials) {
+        std::vector<Network> nets(amount, net);
+        for(Network& this_net: nets)
+            default_weight_reset(this_net);
+        std::vector<HyperParameter> hys(amount, hy);
+        test_lockstep(nets, hys, repetitions);
+        hy = hys.back();
+        return hys;
+    }
+    std::vector<HyperParameter> hys;
+    for(size_t repetition: repetitions) {
+        default_weight_reset(net);
+        test(net, hy, repetition);
+        hys.push_back(hy);
+    }
+    return hys;
+}
+
+// probes whose cost explodes fail early instead of using up their epochs
+inline void check_probe_divergence(HyperParameter& hy) {
+    if(!hy.divergence_factor)
+        hy.divergence_factor = 10.0f;
+}
+
+// summed improvement of eval accuracy
+// diverged runs always lose
+inline float probe_delta(HyperParameter& result) {
+    if(result.learn_status == LearnStatus::Diverged) {
+        log_hyper_extra("probe diverged after {} epochs", result.eval_accuracies.size());
+        return -std::numeric_limits<float>::infinity();
+    }
+    return get_sum_delta(result.eval_accuracies.begin(), result.eval_accuracies.end());
 }
 
 // use multiple different sets of weights and take average
 inline float test_eval_accuracies(Network net, HyperParameter& hy, size_t amount) {
     float delta_sum = 0;
-    for(size_t i = 0; i < amount; ++i) {
-        default_weight_reset(net);
-        test(net, hy);
-        delta_sum += get_sum_delta(hy.eval_accuracies.begin(), hy.eval_accuracies.end());
-    }
+    for(HyperParameter& result: test_repetitions(net, hy, amount))
+        delta_sum += probe_delta(result);
     return delta_sum;
 }
 
 // use multiple different sets of weights and take average
 inline float test_eval_accuracies_over_time(Network net, HyperParameter& hy, size_t amount) {
     float delta_over_time_sum = 0;
-    for(size_t i = 0; i < amount; ++i) {
-        default_weight_reset(net);
-        test(net, hy);
-        delta_over_time_sum += get_sum_delta(hy.eval_accuracies.begin(), hy.eval_accuracies.end()) / hy.learn_time;
-    }
+    for(HyperParameter& result: test_repetitions(net, hy, amount))
+        delta_over_time_sum += probe_delta(result) / result.learn_time;
     return delta_over_time_sum;
 }
 
@@ -37,28 +142,33 @@ inline float test_eval_accuracies_over_time(Network net, HyperParameter& hy, siz
 // true when majority is decreasing
 inline bool test_train_costs_decrease(Network net, HyperParameter& hy, size_t amount) {
     float decreases = 0;
-    for(size_t i = 0; i < amount; ++i) {
-        default_weight_reset(net);
-        test(net, hy);
-        decreases += strictly_monotone_decrease(hy.train_costs);
-    }
+    for(HyperParameter& result: test_repetitions(net, hy, amount))
+        decreases += result.learn_status != LearnStatus::Diverged && strictly_monotone_decrease(result.train_costs);
     return std::round(decreases / amount);
 }
 
-void coarse_hyper_surf(const Network& net, HyperParameter& hy) {
+void coarse_hyper_surf(const Network& net, HyperParameter& hy, const std::string& throughput_path) {
     log_hyper_general("Coarse Hyper Surfing...");
     // using no learning rate schedule
     size_t               max_epochs_buffer             = hy.max_epochs;
     LearningScheduleType learning_schedule_type_buffer = hy.learning_schedule_type;
 
-    log_hyper_general("Find order of magnitude of eta threshold...");
-    coarse_eta_surf(net, hy);
+    log_hyper_general("Find eta threshold with range test...");
+    eta_range_test(net, hy);
 
     log_hyper_general("Coarse lambda surf...");
     coarse_lambda_l2_surf(net, hy);
 
     log_hyper_general("Surf mini batch size...");
-    mini_batch_size_surf(net, hy);
+    ThroughputTable table;
+    if(!throughput_path.empty() && std::ifstream(throughput_path))
+        load_json_throughput_table(table, throughput_path);
+    if(!table.matches(net, hy)) {
+        table = calibrate_throughput(net, hy, default_calibration_sizes(hy));
+        if(!throughput_path.empty())
+            save_json(table, throughput_path);
+    }
+    calibrated_mini_batch_size_surf(net, hy, table);
 
     hy.max_epochs             = max_epochs_buffer;
     hy.learning_schedule_type = learning_schedule_type_buffer;
@@ -72,6 +182,7 @@ void coarse_hyper_surf(const Network& net, HyperParameter& hy) {
 
 void default_coarse_surf(const Network& net, HyperParameter& hy, float& h_parameter, size_t first_epochs, size_t max_tries, size_t amount) {
     hy.reset_monitor();
+    check_probe_divergence(hy);
     hy.max_epochs             = first_epochs;
     hy.learning_schedule_type = LearningScheduleType::None;
     hy.monitor_eval_accuracy  = true;
@@ -119,6 +230,7 @@ void coarse_lambda_l2_surf(const Network& net, HyperParameter& hy, size_t first_
 
 void mini_batch_size_surf(const Network& net, HyperParameter& hy, size_t first_epochs, size_t depth, size_t amount) {
     hy.reset_monitor();
+    check_probe_divergence(hy);
     hy.monitor_eval_accuracy  = true;
     hy.learning_schedule_type = LearningScheduleType::None;
     hy.max_epochs             = first_epochs;
@@ -164,8 +276,140 @@ void mini_batch_size_surf(const Network& net, HyperParameter& hy, size_t first_e
     log_hyper_extra("found best mini batch size: {}; set eta threshold to {}", hy.mini_batch_size, hy.init_eta);
 }
 
+void calibrated_mini_batch_size_surf(const Network& net, HyperParameter& hy, const ThroughputTable& table, size_t first_epochs, size_t max_probes, size_t amount) {
+    if(table.mini_batch_sizes.empty() || !max_probes)
+        raise_critical("Calibrated mini batch size surf requires a throughput table and at least one probe.");
+    if(!table.matches(net, hy))
+        log_hyper_warn("Throughput table was measured with another network or optimizer.");
+    hy.reset_monitor();
+    check_probe_divergence(hy);
+    hy.monitor_eval_accuracy  = true;
+    hy.learning_schedule_type = LearningScheduleType::None;
+    hy.max_epochs             = first_epochs;
+
+    // evenly spaced over table <- powers of two by default
+    std::vector<size_t> candidates;
+    size_t              n_table  = table.mini_batch_sizes.size();
+    size_t              n_probes = std::min(max_probes, n_table);
+    for(size_t i = 0; i < n_probes; ++i) {
+        size_t idx = n_probes == 1 ? n_table - 1 : i * (n_table - 1) / (n_probes - 1);
+        candidates.push_back(table.mini_batch_sizes[idx]);
+    }
+
+    // all probes see the same amount of samples
+    float  samples              = static_cast<float>(first_epochs + 1) * hy.training_data->get_x().n_cols;
+    size_t best_mini_batch_size = hy.mini_batch_size;
+    float  best_eta             = hy.init_eta;
+    float  best_gain            = -std::numeric_limits<float>::max();
+    for(size_t candidate: candidates) {
+        // scale eta anti-proportional to mini batch size
+        float          eta      = hy.init_eta * static_cast<float>(hy.mini_batch_size) / static_cast<float>(candidate);
+        HyperParameter probe_hy = hy;
+        probe_hy.mini_batch_size = candidate;
+        probe_hy.init_eta        = eta;
+
+        float delta_per_sample = test_eval_accuracies(net, probe_hy, amount) / amount / samples;
+        float gain             = delta_per_sample * table.get(candidate);
+        log_hyper_extra("mini batch size {} with eta {}: {} accuracy per sample, {} samples per second -> {} per second",
+                        candidate, eta, delta_per_sample, table.get(candidate), gain);
+        if(gain > best_gain) {
+            best_gain            = gain;
+            best_mini_batch_size = candidate;
+            best_eta             = eta;
+        }
+    }
+    hy.mini_batch_size = best_mini_batch_size;
+    hy.init_eta        = best_eta;
+    log_hyper_extra("found best mini batch size: {}; set eta threshold to {}", hy.mini_batch_size, hy.init_eta);
+}
+
+float eta_range_test(const Network& net, HyperParameter& hy, float min_eta, float max_eta, size_t n_steps, const std::string& curve_path) {
+    if(hy.training_data == nullptr)
+        raise_critical("training_data needs to be given");
+    if(min_eta <= 0.0f || max_eta <= min_eta || n_steps < 3)
+        raise_critical("Range test requires 0 < min_eta < max_eta and at least three steps.");
+    Network           current_net = net;
+    TrainingWorkspace workspace(current_net, hy);
+    size_t            n = hy.training_data->get_x().n_cols;
+    // loss comes from feedforward of backprop <- no extra pass
+    InFlightMetrics& in_flight = workspace.train_monitor.in_flight;
+    in_flight.cost             = true;
+    in_flight.accuracy         = false;
+    // constant factor between two steps
+    float growth = std::pow(max_eta / min_eta, 1.0f / (n_steps - 1));
+    // exponential moving average of loss
+    float smoothing = 0.98f;
+
+    std::vector<float> etas, losses, smoothed_losses;
+    float              average            = 0.0f;
+    float              best_loss          = std::numeric_limits<float>::max();
+    float              eta                = min_eta;
+    Data               this_training_data = hy.training_data->get_shuffled();
+    for(size_t step = 0, offset = 0; step < n_steps; ++step, offset += hy.mini_batch_size) {
+        // start new epoch when necessary
+        if(offset >= n) {
+            this_training_data = hy.training_data->get_shuffled();
+            offset             = 0;
+        }
+        size_t                     length = offset + hy.mini_batch_size >= n ? n - offset : hy.mini_batch_size;
+        const arma::subview<float> x      = this_training_data.get_mini_x(offset, length);
+        const arma::subview<float> y      = this_training_data.get_mini_y(offset, length);
+
+        // loss of batch before update
+        in_flight.reset();
+        update_mini_batch(current_net, x, y, workspace, hy, eta, n);
+        float loss = in_flight.cost_sum / in_flight.n;
+        // correct bias of average starting at 0
+        average = smoothing * average + (1.0f - smoothing) * loss;
+
+        float smoothed_loss = average / (1.0f - std::pow(smoothing, static_cast<float>(step + 1)));
+        etas.push_back(eta);
+        losses.push_back(loss);
+        smoothed_losses.push_back(smoothed_loss);
+        if(!std::isfinite(smoothed_loss) || smoothed_loss > 4.0f * best_loss) {
+            log_hyper_extra("loss exploded at eta {}; range test stopped after {} steps", eta, step + 1);
+            break;
+        }
+        best_loss = std::min(best_loss, smoothed_loss);
+        eta *= growth;
+    }
+
+    if(!curve_path.empty()) {
+        std::ofstream file(curve_path);
+        if(!file)
+            raise_critical("Can't open range test output file: {}", curve_path);
+        file << "eta;loss;smoothed_loss" << std::endl;
+        for(size_t i = 0; i < etas.size(); ++i)
+            file << etas[i] << ";" << losses[i] << ";" << smoothed_losses[i] << std::endl;
+    }
+
+    // steepest decrease before minimum of smoothed loss
+    size_t min_idx      = std::min_element(smoothed_losses.begin(), smoothed_losses.end()) - smoothed_losses.begin();
+    size_t steepest_idx = 0;
+    float  steepest     = 0.0f;
+    for(size_t i = 1; i + 1 <= min_idx && i + 1 < etas.size(); ++i) {
+        // central difference with respect to log eta
+        float slope = (smoothed_losses[i + 1] - smoothed_losses[i - 1]) / std::log(etas[i + 1] / etas[i - 1]);
+        if(slope < steepest) {
+            steepest     = slope;
+            steepest_idx = i;
+        }
+    }
+    // no decrease is a bad range, not a bad network <- keep given eta
+    if(!steepest_idx) {
+        log_hyper_warn("Loss didn't decrease during range test between eta {} and {}; eta threshold stays {}", min_eta, max_eta,
+                       hy.init_eta);
+        return hy.init_eta;
+    }
+    hy.init_eta = etas[steepest_idx];
+    log_hyper_extra("Range test complete; minimal loss {} at eta {}; eta threshold set to {}", smoothed_losses[min_idx],
+                    etas[min_idx], hy.init_eta);
+    return hy.init_eta;
+}
+
 void coarse_eta_surf(const Network& net, HyperParameter& hy, float start_eta, size_t first_epochs, size_t max_tries, size_t amount) {
     hy.reset_monitor();
+    check_probe_divergence(hy);
     hy.init_eta               = start_eta;
     hy.learning_schedule_type = LearningScheduleType::None;
     hy.max_epochs             = first_epochs;
@@ -205,7 +449,7 @@ void coarse_eta_surf(const Network& net, HyperParameter& hy, float start_eta, si
     raise_critical("Failed to find order of magnitude of eta.");
 }
 
-void bounce_hyper_surf(const Network& net, HyperParameter& hy, size_t fine_surfs, size_t surf_depth) {
+void bounce_hyper_surf(const Network& net, HyperParameter& hy, size_t fine_surfs, size_t surf_depth, size_t fork_epochs) {
     log_hyper_general("Bounce Hyper Surf...");
     hy.mu = 0.5f;
     for(size_t i = 0; i < fine_surfs; ++i) {
@@ -214,15 +458,15 @@ void bounce_hyper_surf(const Network& net, HyperParameter& hy, size_t fine_surfs
         default_weight_reset(this_net);
 
         log_hyper_general("{}. fine mu adjustment...", i);
-        default_fine_surf(this_net, hy, hy.mu, 0.0f, 1.0f, surf_depth);
+        default_fine_surf(this_net, hy, hy.mu, 0.0f, 1.0f, surf_depth, fork_epochs);
         log_hyper_general("mu set to: {}", hy.mu);
 
         log_hyper_general("{}. fine init_eta adjustment...", i);
-        default_fine_surf(this_net, hy, hy.init_eta, hy.init_eta / 2.0f, hy.init_eta * 2.0f, surf_depth);
+        default_fine_surf(this_net, hy, hy.init_eta, hy.init_eta / 2.0f, hy.init_eta * 2.0f, surf_depth, fork_epochs);
         log_hyper_general("init_eta set to: {}", hy.init_eta);
 
         log_hyper_general("{}. fine lambda adjustment...", i);
-        default_fine_surf(this_net, hy, hy.lambda_l2, hy.lambda_l2 / 2.0f, hy.lambda_l2 * 2.0f, surf_depth);
+        default_fine_surf(this_net, hy, hy.lambda_l2, hy.lambda_l2 / 2.0f, hy.lambda_l2 * 2.0f, surf_depth, fork_epochs);
         log_hyper_general("lambda_l2 set to: {}", hy.lambda_l2);
     }
     log_hyper_general("Bounce Hyper surf complete:");
@@ -231,8 +475,24 @@ void bounce_hyper_surf(const Network& net, HyperParameter& hy, size_t fine_surfs
     log_hyper_general("\tlambda_l2: {}", hy.lambda_l2);
 }
 
-void default_fine_surf(const Network& net, HyperParameter& hy, float& h_parameter, float min, float max, size_t depth) {
+void default_fine_surf(const Network& net, HyperParameter& hy, float& h_parameter, float min, float max, size_t depth, size_t fork_epochs) {
     hy.monitor_eval_accuracy = true;
+    check_probe_divergence(hy);
+    // shared first epochs of all probes
+    Network                        base_net = net;
+    HyperParameter                 base_hy  = hy;
+    std::unique_ptr<TrainingState> base_state;
+    if(fork_epochs) {
+        log_hyper_extra("training {} epochs shared by all probes", fork_epochs);
+        base_state = fork_base(base_net, base_hy, fork_epochs);
+    }
+    auto probe = [&]() {
+        if(base_state)
+            fork_test(base_net, *base_state, base_hy, hy);
+        else
+            test(net, hy);
+    };
+
     for(size_t i = 0; i < depth; ++i) {
         float middle = h_parameter;
         // between min and middle
@@ -240,15 +500,28 @@ void default_fine_surf(const Network& net, HyperParameter& hy, float& h_paramete
         // between middle and max
         float right_value = middle + (max - middle) / 2;
 
-        // evaluate left value
-        h_parameter = left_value;
-        test(net, hy);
-        float left_delta = get_sum_delta(hy.eval_accuracies.begin(), hy.eval_accuracies.end());
-
-        // evaluate right value
-        h_parameter = right_value;
-        test(net, hy);
-        float right_delta = get_sum_delta(hy.eval_accuracies.begin(), hy.eval_accuracies.end());
+        float left_delta, right_delta;
+        if(hy.lockstep_trials && !base_state) {
+            // evaluate both values at once
+            std::vector<HyperParameter> hys;
+            h_parameter = left_value;
+            hys.push_back(hy);
+            h_parameter = right_value;
+            hys.push_back(hy);
+            test_lockstep({net, net}, hys, {0, 0});
+            left_delta  = probe_delta(hys[0]);
+            right_delta = probe_delta(hys[1]);
+        } else {
+            // evaluate left value
+            h_parameter = left_value;
+            probe();
+            left_delta = probe_delta(hy);
+
+            // evaluate right value
+            h_parameter = right_value;
+            probe();
+            right_delta = probe_delta(hy);
+        }
 
         if(left_delta > right_delta) {
             // leave min
@@ -262,4 +535,232 @@ void default_fine_surf(const Network& net, HyperParameter& hy, float& h_paramete
         h_parameter = min + (max - min) / 2;
     }
 }
+
+// one configuration in multi fidelity surfing
+struct Trial {
+    HyperParameter hy;
+    // weights before first rung
+    Network initial_net;
+    Network net;
+    // optimizer moments, schedule progress and epochs trained so far of SurfBudget::Epochs
+    // shared by copies <- only the best trial gets copied, after training
+    std::shared_ptr<TrainingState> state;
+    // eval accuracy of last epoch
+    float score = 0.0f;
+};
+
+// log uniform in [min; max]
+inline float log_uniform(std::mt19937& rng, float min, float max) {
+    std::uniform_real_distribution<float> distribution(std::log(min), std::log(max));
+    return std::exp(distribution(rng));
+}
+
+// random configuration around current values of hy
+inline HyperParameter sample_configuration(const HyperParameter& hy, std::mt19937& rng) {
+    HyperParameter config  = hy;
+    config.init_eta        = log_uniform(rng, hy.init_eta / 10.0f, hy.init_eta * 10.0f);
+    config.lambda_l2       = hy.lambda_l2 ? log_uniform(rng, hy.lambda_l2 / 10.0f, hy.lambda_l2 * 10.0f)
+                                          : log_uniform(rng, 1e-3f, 10.0f);
+    config.mu              = std::uniform_real_distribution<float>(0.0f, 0.99f)(rng);
+    float min_batch_size   = std::max<float>(1.0f, hy.mini_batch_size / 4.0f);
+    float max_batch_size   = std::min<float>(hy.training_data->get_x().n_cols, hy.mini_batch_size * 4.0f);
+    config.mini_batch_size = static_cast<size_t>(std::round(log_uniform(rng, min_batch_size, max_batch_size)));
+    return config;
+}
+
+// train trial with budget
+inline void train_trial(Trial& trial, size_t budget, size_t max_budget, SurfBudget budget_type) {
+    trial.hy.reset_results();
+    switch(budget_type) {
+    case SurfBudget::Epochs:
+        // continue where last rung stopped <- max_epochs counts epochs of state, sgd runs max_epochs + 1 epochs
+        if(!trial.state)
+            trial.state = std::make_shared<TrainingState>(trial.net, trial.hy);
+        trial.hy.max_epochs = budget - 1;
+        sgd(trial.net, trial.hy, *trial.state);
+        break;
+    case SurfBudget::TrainingSubset: {
+        // restart from initial weights with more data
+        const Data* training_data = trial.hy.training_data;
+        size_t      length        = std::max<size_t>(1, training_data->get_x().n_cols * budget / max_budget);
+        Data        sub_data      = training_data->get_sub(0, length);
+        trial.hy.training_data    = &sub_data;
+        trial.net                 = trial.initial_net;
+        sgd(trial.net, trial.hy);
+        trial.hy.training_data = training_data;
+        break;
+    }
+    }
+    // diverged trials get eliminated first
+    bool failed = trial.hy.learn_status == LearnStatus::Diverged || trial.hy.eval_accuracies.empty();
+    trial.score = failed ? -std::numeric_limits<float>::infinity() : trial.hy.eval_accuracies.back();
+}
+
+// return best trial
+inline Trial run_successive_halving(std::vector<Trial>& trials,
+                                    size_t              budget,
+                                    size_t              max_budget,
+                                    size_t              reduction,
+                                    SurfBudget          budget_type) {
+    while(true) {
+        log_hyper_extra("training {} configurations with budget {}", trials.size(), budget);
+        for(Trial& trial: trials) {
+            train_trial(trial, budget, max_budget, budget_type);
+            log_hyper_extra("\teta: {} lambda_l2: {} mu: {} mini batch size: {} -> {}", trial.hy.init_eta,
+                            trial.hy.lambda_l2, trial.hy.mu, trial.hy.mini_batch_size, trial.score);
+        }
+        std::sort(trials.begin(), trials.end(), [](const Trial& a, const Trial& b) { return a.score > b.score; });
+        if(trials.size() <= 1 || budget >= max_budget)
+            break;
+        // keep best fraction
+        trials.resize(std::max<size_t>(1, trials.size() / reduction));
+        budget = std::min(budget * reduction, max_budget);
+    }
+    return trials[0];
+}
+
+inline void apply_configuration(HyperParameter& hy, const HyperParameter& config) {
+    hy.init_eta        = config.init_eta;
+    hy.lambda_l2       = config.lambda_l2;
+    hy.mu              = config.mu;
+    hy.mini_batch_size = config.mini_batch_size;
+}
+
+void successive_halving_surf(const Network& net,
+                             HyperParameter& hy,
+                             size_t          n_configs,
+                             size_t          min_budget,
+                             size_t          max_budget,
+                             size_t          reduction,
+                             SurfBudget      budget,
+                             unsigned        seed) {
+    log_hyper_general("Successive Halving Surf...");
+    if(!min_budget || min_budget > max_budget || reduction < 2)
+        raise_critical("Successive halving requires 0 < min_budget <= max_budget and reduction >= 2.");
+    size_t               max_epochs_buffer             = hy.max_epochs;
+    LearningScheduleType learning_schedule_type_buffer = hy.learning_schedule_type;
+    hy.reset_monitor();
+    hy.monitor_eval_accuracy  = true;
+    hy.learning_schedule_type = LearningScheduleType::None;
+    check_probe_divergence(hy);
+
+    std::mt19937       rng(seed);
+    std::vector<Trial> trials(n_configs);
+    for(Trial& trial: trials) {
+        // every configuration starts with its own weights
+        trial.hy          = sample_configuration(hy, rng);
+        trial.initial_net = net;
+        default_weight_reset(trial.initial_net);
+        trial.net = trial.initial_net;
+    }
+    Trial best = run_successive_halving(trials, min_budget, max_budget, reduction, budget);
+    apply_configuration(hy, best.hy);
+
+    hy.max_epochs             = max_epochs_buffer;
+    hy.learning_schedule_type = learning_schedule_type_buffer;
+    log_hyper_general("Successive Halving surf complete with eval accuracy {}:", best.score);
+    log_hyper_general("\tinit_eta: {}", hy.init_eta);
+    log_hyper_general("\tlambda_l2: {}", hy.lambda_l2);
+    log_hyper_general("\tmu: {}", hy.mu);
+    log_hyper_general("\tmini_batch_size: {}", hy.mini_batch_size);
+}
+
+void hyperband_surf(const Network& net, HyperParameter& hy, size_t max_budget, size_t reduction, SurfBudget budget, unsigned seed) {
+    log_hyper_general("Hyperband Surf...");
+    if(!max_budget || reduction < 2)
+        raise_critical("Hyperband requires max_budget > 0 and reduction >= 2.");
+    size_t               max_epochs_buffer             = hy.max_epochs;
+    LearningScheduleType learning_schedule_type_buffer = hy.learning_schedule_type;
+    hy.reset_monitor();
+    hy.monitor_eval_accuracy  = true;
+    hy.learning_schedule_type = LearningScheduleType::None;
+    check_probe_divergence(hy);
+
+    // amount of brackets - 1
+    size_t s_max = 0;
+    for(size_t b = max_budget; b >= reduction; b /= reduction)
+        ++s_max;
+
+    std::mt19937   rng(seed);
+    HyperParameter base = hy;
+    Trial          best;
+    bool           got_first = false;
+    for(size_t s = s_max + 1; s-- > 0;) {
+        // many configurations with small budget first
+        size_t reduction_pow = static_cast<size_t>(std::pow(reduction, s));
+        size_t n_configs     = static_cast<size_t>(std::ceil((s_max + 1.0f) / (s + 1.0f) * reduction_pow));
+        size_t min_budget    = std::max<size_t>(1, max_budget / reduction_pow);
+        log_hyper_extra("bracket {}: {} configurations starting with budget {}", s, n_configs, min_budget);
+
+        std::vector<Trial> trials(n_configs);
+        for(Trial& trial: trials) {
+            trial.hy          = sample_configuration(base, rng);
+            trial.initial_net = net;
+            default_weight_reset(trial.initial_net);
+            trial.net = trial.initial_net;
+        }
+        Trial bracket_best = run_successive_halving(trials, min_budget, max_budget, reduction, budget);
+        if(!got_first || bracket_best.score > best.score) {
+            best      = bracket_best;
+            got_first = true;
+        }
+    }
+    apply_configuration(hy, best.hy);
+
+    hy.max_epochs             = max_epochs_buffer;
+    hy.learning_schedule_type = learning_schedule_type_buffer;
+    log_hyper_general("Hyperband surf complete with eval accuracy {}:", best.score);
+    log_hyper_general("\tinit_eta: {}", hy.init_eta);
+    log_hyper_general("\tlambda_l2: {}", hy.lambda_l2);
+    log_hyper_general("\tmu: {}", hy.mu);
+    log_hyper_general("\tmini_batch_size: {}", hy.mini_batch_size);
+}
+
+void compare_optimizers(const Network& net, HyperParameter& hy, const std::vector<std::pair<OptimizerType, float>>& candidates, size_t amount) {
+    log_hyper_general("Comparing optimizers...");
+    if(!hy.target_accuracy)
+        raise_critical("target_accuracy has to be defined to compare optimizers.");
+    hy.reset_monitor();
+    hy.monitor_eval_accuracy = true;
+    hy.stop_at_target        = true;
+    check_probe_divergence(hy);
+
+    float base_epochs  = 0.0f;
+    float base_seconds = 0.0f;
+    for(size_t candidate_idx = 0; candidate_idx < candidates.size(); ++candidate_idx) {
+        hy.optimizer_type = candidates[candidate_idx].first;
+        hy.init_eta       = candidates[candidate_idx].second;
+
+        float   epochs_sum  = 0.0f;
+        float   seconds_sum = 0.0f;
+        size_t  reached     = 0;
+        Network this_net    = net;
+        for(size_t i = 0; i < amount; ++i) {
+            default_weight_reset(this_net);
+            test(this_net, hy, i);
+            if(hy.epochs_to_target) {
+                epochs_sum += hy.epochs_to_target;
+                seconds_sum += hy.time_to_target / 1e9f;
+                ++reached;
+            }
+        }
+        std::string name = Optimizer::get(hy.optimizer_type)->to_str();
+        if(!reached) {
+            log_hyper_general("\t{} with eta {}: target never reached", name, hy.init_eta);
+            continue;
+        }
+        float epochs  = epochs_sum / reached;
+        float seconds = seconds_sum / reached;
+        if(candidate_idx == 0) {
+            base_epochs  = epochs;
+            base_seconds = seconds;
+        }
+        log_hyper_general("\t{} with eta {}: {} epochs, {} seconds to target ({} / {} runs reached it)", name,
+                          hy.init_eta, epochs, seconds, reached, amount);
+        if(base_epochs && candidate_idx != 0)
+            log_hyper_general("\t\t{}x epochs, {}x seconds of {}", epochs / base_epochs, seconds / base_seconds,
+                              Optimizer::get(candidates[0].first)->to_str());
+    }
+    hy.stop_at_target = false;
+}
 } // namespace NeuralNet
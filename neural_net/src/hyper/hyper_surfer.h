@@ -1,17 +1,25 @@
 #pragma once
+#include "hyper/throughput.h"
 #include "learn/learn.h"
 #include "net/net.h"
 
+#include <string>
+
 namespace NeuralNet {
+// resource that gets increased for promising configurations
+enum class SurfBudget : uint8_t { Epochs = 0,
+                                  TrainingSubset };
+
 ////////////
 // coarse //
 ////////////
 // optimize coarse
-// changing: monitors, init_eta, lambda_l2, mini_batch_size
-void coarse_hyper_surf(const Network& net, HyperParameter& hy);
+// throughput_path given -> reuse throughput table stored there when it matches, otherwise calibrate and store it
+// changing: monitors, init_eta, lambda_l2, mini_batch_size, divergence_factor
+void coarse_hyper_surf(const Network& net, HyperParameter& hy, const std::string& throughput_path = "");
 
 // using eval accuracy to find best order of magnitude of supplied parameter
-// changing: monitors, max_epochs, h_parameter
+// changing: monitors, max_epochs, h_parameter, divergence_factor
 void default_coarse_surf(const Network& net, HyperParameter& hy, float& h_parameter, size_t first_epochs = 10, size_t max_tries = 35, size_t amount = 3);
 
 // wrapper of default_coarse_surf for lambda_l2
@@ -19,25 +27,80 @@ void coarse_lambda_l2_surf(const Network& net, HyperParameter& hy, size_t first_
 
 // find mini batch size with least amount of time required
 // scale init_eta anti-proportionally to mini_batch_size
-// changing: monitors, max_epochs, min_batch_size, init_eta
+// changing: monitors, max_epochs, min_batch_size, init_eta, divergence_factor
 void mini_batch_size_surf(const Network& net, HyperParameter& hy, size_t first_epochs = 10, size_t depth = 15, size_t amount = 3);
 
+// learning rate range test; replaces coarse_eta_surf with a single training pass
+// eta grows exponentially from min_eta to max_eta over n_steps mini batches
+// record training loss of each mini batch before its update, stop when smoothed loss explodes
+// init_eta gets set to eta of steepest decrease of smoothed loss
+// loss not decreasing -> warning, init_eta stays
+// curve_path given -> write eta;loss;smoothed_loss of each step as csv
+// changing: init_eta
+float eta_range_test(const Network& net, HyperParameter& hy, float min_eta = 1e-4f, float max_eta = 100.0f, size_t n_steps = 100, const std::string& curve_path = "");
+
+// find mini batch size with biggest eval accuracy gain per second of pure training time
+// gain per sample from short probes times samples per second of table
+// probe at most max_probes sizes of table, evenly spaced
+// scale init_eta anti-proportionally to mini_batch_size
+// changing: monitors, max_epochs, mini_batch_size, init_eta, divergence_factor
+void calibrated_mini_batch_size_surf(const Network& net, HyperParameter& hy, const ThroughputTable& table, size_t first_epochs = 3, size_t max_probes = 5, size_t amount = 2);
+
 // find order of magnitude of initial eta
 // find threshold of decrease in first epochs
-// changing: monitors, init_eta, max_epochs
+// changing: monitors, init_eta, max_epochs, divergence_factor
 void coarse_eta_surf(const Network& net, HyperParameter& hy, float start_eta = 0.01f, size_t first_epochs = 10, size_t max_tries = 35, size_t amount = 3);
 
 //////////
 // fine //
 //////////
 // optimize one hyper parameter after another, closing in to good values
-// changing: monitors, mu, init_eta, lambda_l2
-void bounce_hyper_surf(const Network& net, HyperParameter& hy, size_t fine_surfs, size_t surf_depth);
+// fork_epochs passed to default_fine_surf
+// changing: monitors, mu, init_eta, lambda_l2, divergence_factor
+void bounce_hyper_surf(const Network& net, HyperParameter& hy, size_t fine_surfs, size_t surf_depth, size_t fork_epochs = 0);
 
 // using eval accuracy to fine tune supplied parameter between min and max
 // using h_parameter as initial pivot
 // taking probe in between [min; middle] and [middle; max]
 // use better result as next [min; max] with middle in exact middle
-// changing: monitors, h_parameter
-void default_fine_surf(const Network& net, HyperParameter& hy, float& h_parameter, float min, float max, size_t depth);
+// fork_epochs > 0 -> train first fork_epochs epochs once with initial pivot, all probes continue from there
+// fork_epochs has to be at most max_epochs
+// changing: monitors, h_parameter, divergence_factor
+void default_fine_surf(const Network& net, HyperParameter& hy, float& h_parameter, float min, float max, size_t depth, size_t fork_epochs = 0);
+
+////////////////////
+// multi fidelity //
+////////////////////
+// sample n_configs random configurations of init_eta, lambda_l2, mu and mini_batch_size around current values
+// train all with min_budget, keep best 1/reduction, multiply budget by reduction and repeat until max_budget
+// Epochs: survivors continue training with budget as total epochs
+// TrainingSubset: survivors retrain hy.max_epochs on budget / max_budget of the training data
+// using eval accuracy of last epoch to compare
+// changing: monitors, init_eta, lambda_l2, mu, mini_batch_size, divergence_factor
+void successive_halving_surf(const Network& net,
+                             HyperParameter& hy,
+                             size_t          n_configs  = 27,
+                             size_t          min_budget = 1,
+                             size_t          max_budget = 27,
+                             size_t          reduction  = 3,
+                             SurfBudget      budget     = SurfBudget::Epochs,
+                             unsigned        seed       = 0);
+
+// run successive halving in multiple brackets
+// from many configurations with small budgets to few configurations with max_budget
+// changing: monitors, init_eta, lambda_l2, mu, mini_batch_size, divergence_factor
+void hyperband_surf(const Network& net,
+                    HyperParameter& hy,
+                    size_t          max_budget = 27,
+                    size_t          reduction  = 3,
+                    SurfBudget      budget     = SurfBudget::Epochs,
+                    unsigned        seed       = 0);
+
+////////////////
+// optimizers //
+////////////////
+// train amount networks with each optimizer and its initial eta until hy.target_accuracy is reached
+// log average epochs and seconds to reach target in comparison to first candidate
+// changing: monitors, optimizer_type, init_eta, stop_at_target, divergence_factor
+void compare_optimizers(const Network& net, HyperParameter& hy, const std::vector<std::pair<OptimizerType, float>>& candidates, size_t amount = 3);
 } // namespace NeuralNet
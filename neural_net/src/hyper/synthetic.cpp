@@ -0,0 +1,111 @@
+#include "synthetic.h"
+
+#include "pch.h"
+
+#include <algorithm>
+#include <random>
+
+namespace NeuralNet {
+Data synthetic_classification(size_t n, size_t x_size, size_t n_classes, float noise, uint32_t seed) {
+    if(!x_size || !n_classes)
+        raise_critical("Synthetic data needs at least one input and one class.");
+    std::mt19937                          rng(seed);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    std::normal_distribution<float>       gaussian(0.0f, noise);
+    std::uniform_int_distribution<size_t> class_distribution(0, n_classes - 1);
+
+    arma::fmat prototypes(x_size, n_classes);
+    for(float& value: prototypes)
+        value = uniform(rng);
+
+    // input above desired output
+    arma::fmat raw(x_size + n_classes, n, arma::fill::zeros);
+    for(size_t idx = 0; idx < n; ++idx) {
+        size_t       class_idx = class_distribution(rng);
+        float*       x         = raw.colptr(idx);
+        const float* prototype = prototypes.colptr(class_idx);
+        for(size_t i = 0; i < x_size; ++i)
+            x[i] = std::clamp(prototype[i] + gaussian(rng), 0.0f, 1.0f);
+        x[x_size + class_idx] = 1.0f;
+    }
+    return {std::move(raw), x_size, n_classes};
+}
+
+Data synthetic_mnist(size_t n, uint32_t seed) {
+    constexpr size_t side      = 28;
+    constexpr size_t x_size    = side * side;
+    constexpr size_t n_classes = 10;
+    std::mt19937     rng(seed);
+
+    // each class is made of a few thick strokes
+    std::uniform_real_distribution<float> position(4.0f, side - 5.0f);
+    std::uniform_int_distribution<int>    n_strokes(2, 4);
+    arma::fmat                            prototypes(x_size, n_classes, arma::fill::zeros);
+    for(size_t class_idx = 0; class_idx < n_classes; ++class_idx) {
+        float* prototype = prototypes.colptr(class_idx);
+        for(int stroke = n_strokes(rng); stroke > 0; --stroke) {
+            float x0 = position(rng), y0 = position(rng);
+            float x1 = position(rng), y1 = position(rng);
+            for(float t = 0.0f; t <= 1.0f; t += 0.02f) {
+                int x = static_cast<int>(x0 + t * (x1 - x0));
+                int y = static_cast<int>(y0 + t * (y1 - y0));
+                // two pixels wide
+                for(int dy = 0; dy < 2; ++dy)
+                    for(int dx = 0; dx < 2; ++dx)
+                        prototype[(y + dy) * side + x + dx] = 1.0f;
+            }
+        }
+    }
+
+    // handwriting moves and breaks strokes
+    std::uniform_int_distribution<int>    shift(-2, 2);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    std::normal_distribution<float>       gaussian(0.0f, 0.1f);
+    std::uniform_int_distribution<size_t> class_distribution(0, n_classes - 1);
+    arma::fmat                            raw(x_size + n_classes, n, arma::fill::zeros);
+    for(size_t idx = 0; idx < n; ++idx) {
+        size_t       class_idx = class_distribution(rng);
+        float*       column    = raw.colptr(idx);
+        const float* prototype = prototypes.colptr(class_idx);
+        int          shift_x   = shift(rng);
+        int          shift_y   = shift(rng);
+        for(int y = 0; y < static_cast<int>(side); ++y)
+            for(int x = 0; x < static_cast<int>(side); ++x) {
+                int   src_x = x - shift_x;
+                int   src_y = y - shift_y;
+                bool  valid = src_x >= 0 && src_y >= 0 && src_x < static_cast<int>(side) && src_y < static_cast<int>(side);
+                float pixel = valid ? prototype[src_y * side + src_x] : 0.0f;
+                // drop pixels of strokes
+                if(pixel > 0.0f && uniform(rng) < 0.1f)
+                    pixel = 0.0f;
+                column[y * side + x] = std::clamp(pixel + gaussian(rng), 0.0f, 1.0f);
+            }
+        column[x_size + class_idx] = 1.0f;
+    }
+    return {std::move(raw), x_size, n_classes};
+}
+
+Data synthetic_football(size_t n, uint32_t seed) {
+    constexpr size_t max_goals = 5;
+    std::mt19937     rng(seed);
+
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    arma::fmat                            raw(3 + 2 * (max_goals + 1), n, arma::fill::zeros);
+    for(size_t idx = 0; idx < n; ++idx) {
+        float* x = raw.colptr(idx);
+        // relative guesses
+        float home = uniform(rng), draw = uniform(rng), guest = uniform(rng);
+        float sum  = home + draw + guest;
+        x[0]       = home / sum;
+        x[1]       = draw / sum;
+        x[2]       = guest / sum;
+
+        // favourites score more
+        std::poisson_distribution<size_t> home_goals(0.4 + 2.4 * x[0]);
+        std::poisson_distribution<size_t> guest_goals(0.4 + 2.4 * x[2]);
+        x[3 + std::min(home_goals(rng), max_goals)]                 = 1.0f;
+        x[3 + max_goals + 1 + std::min(guest_goals(rng), max_goals)] = 1.0f;
+    }
+    return {std::move(raw), 3, 2 * (max_goals + 1)};
+}
+} // namespace NeuralNet
@@ -0,0 +1,23 @@
+#pragma once
+#include "hyper/data.h"
+
+#include <cstdint>
+
+namespace NeuralNet {
+// generated data with learnable structure, same seed -> same data
+// meant for benchmarks without downloading real data sets
+
+// n_classes random prototypes in [0; 1]^x_size
+// each data set is a prototype with gaussian noise of standard deviation noise, clamped to [0; 1]
+// desired output: one hot class
+Data synthetic_classification(size_t n, size_t x_size, size_t n_classes, float noise, uint32_t seed);
+
+// 28x28 images of 10 classes like mnist
+// each class is a random pattern of bright strokes; data sets drop some pixels and get noise
+Data synthetic_mnist(size_t n, uint32_t seed);
+
+// shape of football data
+// input: three relative guesses for home win, draw and guest win summing up to 1
+// output: one hot home goals and one hot guest goals in [0; 5]; poisson distributed with rates following the guesses
+Data synthetic_football(size_t n, uint32_t seed);
+} // namespace NeuralNet
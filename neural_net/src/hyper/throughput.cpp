@@ -0,0 +1,117 @@
+#include "throughput.h"
+
+#include "learn/learn.h"
+#include "pch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+namespace NeuralNet {
+float ThroughputTable::get(size_t mini_batch_size) const {
+    if(mini_batch_sizes.empty())
+        raise_critical("Throughput table is empty.");
+    if(mini_batch_size <= mini_batch_sizes.front())
+        return samples_per_second.front();
+    for(size_t i = 1; i < mini_batch_sizes.size(); ++i) {
+        if(mini_batch_size <= mini_batch_sizes[i]) {
+            float fraction = static_cast<float>(mini_batch_size - mini_batch_sizes[i - 1]) /
+                             (mini_batch_sizes[i] - mini_batch_sizes[i - 1]);
+            return samples_per_second[i - 1] + fraction * (samples_per_second[i] - samples_per_second[i - 1]);
+        }
+    }
+    return samples_per_second.back();
+}
+
+std::vector<size_t> default_calibration_sizes(const HyperParameter& hy) {
+    size_t              n = hy.training_data->get_x().n_cols;
+    std::vector<size_t> mini_batch_sizes;
+    for(size_t size = 1; size <= n; size *= 2)
+        mini_batch_sizes.push_back(size);
+    return mini_batch_sizes;
+}
+
+ThroughputTable calibrate_throughput(const Network&             net,
+                                     const HyperParameter&      hy,
+                                     const std::vector<size_t>& mini_batch_sizes,
+                                     float                      min_seconds,
+                                     size_t                     max_samples) {
+    log_hyper_general("Calibrating throughput of {} mini batch sizes...", mini_batch_sizes.size());
+    if(hy.training_data == nullptr)
+        raise_critical("training_data needs to be given");
+    ThroughputTable table;
+    table.sizes            = net.sizes;
+    table.optimizer_type   = hy.optimizer_type;
+    table.mini_batch_sizes = mini_batch_sizes;
+    std::sort(table.mini_batch_sizes.begin(), table.mini_batch_sizes.end());
+
+    const Data& data = *hy.training_data;
+    size_t      n    = data.get_x().n_cols;
+    for(size_t mini_batch_size: table.mini_batch_sizes) {
+        if(!mini_batch_size || mini_batch_size > n)
+            raise_critical("Can't calibrate mini batch size {} with {} data sets.", mini_batch_size, n);
+        // learning doesn't matter, only the time
+        Network           current_net = net;
+        TrainingWorkspace workspace(current_net, hy);
+        size_t            min_samples = std::min(n, max_samples);
+
+        // warm up caches and allocations
+        update_mini_batch(current_net,
+                          data.get_mini_x(0, mini_batch_size),
+                          data.get_mini_y(0, mini_batch_size),
+                          workspace,
+                          hy,
+                          hy.init_eta,
+                          n);
+
+        size_t samples = 0;
+        float  seconds = 0.0f;
+        auto   begin   = std::chrono::high_resolution_clock::now();
+        for(size_t offset = 0; samples < min_samples || seconds < min_seconds; offset += mini_batch_size) {
+            if(offset + mini_batch_size > n)
+                offset = 0;
+            update_mini_batch(current_net,
+                              data.get_mini_x(offset, mini_batch_size),
+                              data.get_mini_y(offset, mini_batch_size),
+                              workspace,
+                              hy,
+                              hy.init_eta,
+                              n);
+            samples += mini_batch_size;
+            seconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - begin).count();
+        }
+        table.samples_per_second.push_back(samples / seconds);
+        log_hyper_extra("\tmini batch size {}: {} samples per second", mini_batch_size, table.samples_per_second.back());
+    }
+    return table;
+}
+
+void load_json_throughput_table(ThroughputTable& table, const std::string& json_path) {
+    std::ifstream file(json_path);
+    if(!file)
+        raise_critical("Can't open input json file '{}'!", json_path);
+    json json_table;
+    file >> json_table;
+    file.close();
+
+    table.sizes              = json_table["sizes"].get<std::vector<size_t>>();
+    table.optimizer_type     = static_cast<OptimizerType>(json_table["optimizer_type"].get<int>());
+    table.mini_batch_sizes   = json_table["mini_batch_sizes"].get<std::vector<size_t>>();
+    table.samples_per_second = json_table["samples_per_second"].get<std::vector<float>>();
+    if(table.mini_batch_sizes.size() != table.samples_per_second.size())
+        raise_critical("Throughput table '{}' is corrupt.", json_path);
+}
+
+void save_json(const ThroughputTable& table, const std::string& path) {
+    json json_table = {{"sizes", table.sizes},
+                       {"optimizer_type", static_cast<int>(table.optimizer_type)},
+                       {"mini_batch_sizes", table.mini_batch_sizes},
+                       {"samples_per_second", table.samples_per_second}};
+
+    std::ofstream file(path);
+    if(!file)
+        raise_critical("Can't open output json file '{}'!", path);
+    file << std::setw(4) << json_table;
+    file.close();
+}
+} // namespace NeuralNet
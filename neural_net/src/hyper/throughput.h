@@ -0,0 +1,40 @@
+#pragma once
+#include "net/net.h"
+
+#include <string>
+#include <vector>
+
+namespace NeuralNet {
+// samples per second of update_mini_batch for several mini batch sizes on this machine
+// only valid for the network sizes and optimizer it was measured with
+struct ThroughputTable {
+    std::vector<size_t> sizes;
+    OptimizerType       optimizer_type = OptimizerType::Momentum;
+    // ascending
+    std::vector<size_t> mini_batch_sizes;
+    std::vector<float>  samples_per_second;
+
+    // true -> measured with same topology and optimizer
+    bool matches(const Network& net, const HyperParameter& hy) const {
+        return sizes == net.sizes && optimizer_type == hy.optimizer_type;
+    }
+
+    // linear interpolation between measured mini batch sizes, clamped at both ends
+    float get(size_t mini_batch_size) const;
+};
+
+// powers of two up to the size of the training data
+std::vector<size_t> default_calibration_sizes(const HyperParameter& hy);
+
+// time update_mini_batch for each mini batch size without monitoring, shuffling or logging
+// each size runs at least min_seconds and at least one epoch worth of samples capped at max_samples
+ThroughputTable calibrate_throughput(const Network&             net,
+                                     const HyperParameter&      hy,
+                                     const std::vector<size_t>& mini_batch_sizes,
+                                     float                      min_seconds = 0.1f,
+                                     size_t                     max_samples = 100000);
+
+void load_json_throughput_table(ThroughputTable& table, const std::string& json_path);
+
+void save_json(const ThroughputTable& table, const std::string& path);
+} // namespace NeuralNet
@@ -0,0 +1,225 @@
+#include "trial_cache.h"
+
+#include "pch.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace NeuralNet {
+static json to_json(const TrialResult& result) {
+    return {{"test_costs", result.test_costs},
+            {"test_accuracies", result.test_accuracies},
+            {"eval_costs", result.eval_costs},
+            {"eval_accuracies", result.eval_accuracies},
+            {"train_costs", result.train_costs},
+            {"train_accuracies", result.train_accuracies},
+            {"learn_time", result.learn_time},
+            {"epochs_to_target", result.epochs_to_target},
+            {"time_to_target", result.time_to_target},
+            {"learn_status", static_cast<int>(result.learn_status)}};
+}
+
+static TrialResult from_json(const json& json_result) {
+    TrialResult result;
+    result.test_costs       = json_result["test_costs"].get<std::vector<float>>();
+    result.test_accuracies  = json_result["test_accuracies"].get<std::vector<float>>();
+    result.eval_costs       = json_result["eval_costs"].get<std::vector<float>>();
+    result.eval_accuracies  = json_result["eval_accuracies"].get<std::vector<float>>();
+    result.train_costs      = json_result["train_costs"].get<std::vector<float>>();
+    result.train_accuracies = json_result["train_accuracies"].get<std::vector<float>>();
+    result.learn_time       = json_result["learn_time"].get<long long>();
+    result.epochs_to_target = json_result["epochs_to_target"].get<size_t>();
+    result.time_to_target   = json_result["time_to_target"].get<long long>();
+    result.learn_status     = static_cast<LearnStatus>(json_result.value("learn_status", 0));
+    return result;
+}
+
+// FNV-1a
+static constexpr uint64_t s_fnv_offset = 14695981039346656037ull;
+
+static void fnv_add(uint64_t& hash, const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for(size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+}
+
+uint64_t fingerprint(const Data& data) {
+    size_t   n_cols = data.get_x().n_cols;
+    size_t   n_rows = data.get_x().n_rows + data.get_y().n_rows;
+    uint64_t hash   = s_fnv_offset;
+    fnv_add(hash, &n_cols, sizeof(n_cols));
+    fnv_add(hash, &n_rows, sizeof(n_rows));
+    // columns are contiguous
+    if(n_cols)
+        fnv_add(hash, data.get_x_ptr(0), n_cols * n_rows * sizeof(float));
+    return hash;
+}
+
+// shape, buffer address and a few evenly spaced values <- cheap check whether memoized fingerprint is still valid
+static uint64_t sample_fingerprint(const Data& data) {
+    size_t      n_cols  = data.get_x().n_cols;
+    size_t      n_rows  = data.get_x().n_rows + data.get_y().n_rows;
+    size_t      n_elem  = n_cols * n_rows;
+    const void* address = n_cols ? data.get_x_ptr(0) : nullptr;
+    uint64_t    hash    = s_fnv_offset;
+    fnv_add(hash, &n_cols, sizeof(n_cols));
+    fnv_add(hash, &n_rows, sizeof(n_rows));
+    fnv_add(hash, &address, sizeof(address));
+    constexpr size_t n_samples = 64;
+    for(size_t i = 0; n_elem && i < n_samples; ++i)
+        fnv_add(hash, data.get_x_ptr(0) + i * (n_elem - 1) / (n_samples - 1), sizeof(float));
+    return hash;
+}
+
+std::string trial_key(const Network& net, const HyperParameter& hy, size_t repetition, const DataFingerprints& fingerprints) {
+    std::stringstream out;
+    // exact round trip of floats
+    out << std::setprecision(9);
+    out << "sizes:";
+    for(size_t size: net.sizes)
+        out << size << ",";
+    // only factorized networks <- keys of other networks stay the same
+    if(std::find(net.linear_layers.begin(), net.linear_layers.end(), true) != net.linear_layers.end()) {
+        out << ";linear:";
+        for(size_t layer_idx = 0; layer_idx < net.num_layers; ++layer_idx)
+            out << net.is_linear(layer_idx);
+    }
+    // only pruned networks; mask stays applied during learning
+    if(net.weight_mask.n_elem) {
+        uint64_t mask_hash = s_fnv_offset;
+        fnv_add(mask_hash, net.weight_mask.memptr(), net.weight_mask.n_elem * sizeof(float));
+        out << ";mask:" << std::hex << mask_hash << std::dec;
+    }
+    out << ";cost:" << net.cost->to_str() << ";post_process:" << net.post_process;
+    out << std::hex << ";train:" << fingerprints.training;
+    out << ";test:" << fingerprints.test;
+    out << ";eval:" << fingerprints.eval << std::dec;
+
+    out << ";eta:" << hy.init_eta << ";mini_batch_size:" << hy.mini_batch_size << ";max_epochs:" << hy.max_epochs
+        << ";mu:" << hy.mu << ";lambda_l1:" << hy.lambda_l1 << ";lambda_l2:" << hy.lambda_l2;
+    out << ";optimizer:" << static_cast<int>(hy.optimizer_type) << ";beta1:" << hy.beta1 << ";beta2:" << hy.beta2
+        << ";epsilon:" << hy.epsilon << ";weight_decay:" << hy.weight_decay;
+    out << ";schedule:" << static_cast<int>(hy.learning_schedule_type) << ";no_improvement_in:" << hy.no_improvement_in
+        << ";stop_eta_fraction:" << hy.stop_eta_fraction << ";decay_rate:" << hy.decay_rate
+        << ";decay_epochs:" << hy.decay_epochs << ";restart_epochs:" << hy.restart_epochs
+        << ";restart_mult:" << hy.restart_mult << ";one_cycle_div:" << hy.one_cycle_div
+        << ";one_cycle_peak:" << hy.one_cycle_peak << ";min_eta:" << hy.min_eta << ";warmup_epochs:" << hy.warmup_epochs;
+    out << ";target_accuracy:" << hy.target_accuracy << ";stop_at_target:" << hy.stop_at_target
+        << ";best_weights_metric:" << static_cast<int>(hy.best_weights_metric) << ";patience:" << hy.patience
+        << ";divergence_check_interval:" << hy.divergence_check_interval << ";divergence_factor:" << hy.divergence_factor;
+    out << ";monitor:" << hy.monitor_test_cost << hy.monitor_test_accuracy << hy.monitor_eval_cost
+        << hy.monitor_eval_accuracy << hy.monitor_train_cost << hy.monitor_train_accuracy
+        << ";async_monitoring:" << hy.async_monitoring << ";train_cost_mode:" << static_cast<int>(hy.train_cost_mode)
+        << ";train_accuracy_mode:" << static_cast<int>(hy.train_accuracy_mode)
+        << ";monitor_subsample_size:" << hy.monitor_subsample_size;
+    out << ";repetition:" << repetition;
+    return out.str();
+}
+
+std::string trial_key(const Network& net, const HyperParameter& hy, size_t repetition) {
+    DataFingerprints fingerprints;
+    fingerprints.training = fingerprint(*hy.training_data);
+    fingerprints.test     = hy.test_data ? fingerprint(*hy.test_data) : 0;
+    fingerprints.eval     = hy.eval_data ? fingerprint(*hy.eval_data) : 0;
+    return trial_key(net, hy, repetition, fingerprints);
+}
+
+TrialCache::TrialCache(const std::string& path)
+    : m_path(path) {
+    std::ifstream file(path);
+    // start empty
+    if(!file)
+        return;
+    json json_cache;
+    try {
+        file >> json_cache;
+    } catch(const json::exception& e) {
+        raise_critical("Trial cache '{}' is corrupt: {}", path, e.what());
+    }
+    for(const auto& [key, json_result]: json_cache["trials"].items())
+        m_results[key] = from_json(json_result);
+    log_hyper_general("Loaded {} cached trials from '{}'", m_results.size(), path);
+}
+
+uint64_t TrialCache::get_fingerprint(const Data* data) {
+    if(!data)
+        return 0;
+    uint64_t            sample   = sample_fingerprint(*data);
+    MemoizedFingerprint& memoized = m_fingerprints[data];
+    // new or changed data
+    if(memoized.sample != sample || !memoized.full) {
+        memoized.sample = sample;
+        memoized.full   = fingerprint(*data);
+    }
+    return memoized.full;
+}
+
+std::string TrialCache::get_key(const Network& net, const HyperParameter& hy, size_t repetition) {
+    DataFingerprints fingerprints;
+    fingerprints.training = get_fingerprint(hy.training_data);
+    fingerprints.test     = get_fingerprint(hy.test_data);
+    fingerprints.eval     = get_fingerprint(hy.eval_data);
+    return trial_key(net, hy, repetition, fingerprints);
+}
+
+bool TrialCache::load(const Network& net, HyperParameter& hy, size_t repetition) {
+    auto it = m_results.find(get_key(net, hy, repetition));
+    if(it == m_results.end())
+        return false;
+    const TrialResult& result = it->second;
+    hy.test_costs             = result.test_costs;
+    hy.test_accuracies        = result.test_accuracies;
+    hy.eval_costs             = result.eval_costs;
+    hy.eval_accuracies        = result.eval_accuracies;
+    hy.train_costs            = result.train_costs;
+    hy.train_accuracies       = result.train_accuracies;
+    hy.learn_time             = result.learn_time;
+    hy.epochs_to_target       = result.epochs_to_target;
+    hy.time_to_target         = result.time_to_target;
+    hy.learn_status           = result.learn_status;
+    ++m_hits;
+    log_hyper_extra("Using cached trial");
+    return true;
+}
+
+void TrialCache::store(const Network& net, const HyperParameter& hy, size_t repetition) {
+    TrialResult& result     = m_results[get_key(net, hy, repetition)];
+    result.test_costs       = hy.test_costs;
+    result.test_accuracies  = hy.test_accuracies;
+    result.eval_costs       = hy.eval_costs;
+    result.eval_accuracies  = hy.eval_accuracies;
+    result.train_costs      = hy.train_costs;
+    result.train_accuracies = hy.train_accuracies;
+    result.learn_time       = hy.learn_time;
+    result.epochs_to_target = hy.epochs_to_target;
+    result.time_to_target   = hy.time_to_target;
+    result.learn_status     = hy.learn_status;
+    write();
+}
+
+void TrialCache::write() const {
+    json json_trials = json::object();
+    for(const auto& [key, result]: m_results)
+        json_trials[key] = to_json(result);
+    json json_cache = {{"trials", json_trials}};
+
+    std::string   tmp_path = m_path + ".tmp";
+    std::ofstream file(tmp_path);
+    if(!file)
+        raise_critical("Can't open trial cache file '{}'!", tmp_path);
+    file << json_cache;
+    file.close();
+    if(!file)
+        raise_critical("Failed to write trial cache file '{}'!", tmp_path);
+#if defined(_WIN32) || defined(_WIN64)
+    // rename doesn't replace existing files
+    std::remove(m_path.c_str());
+#endif
+    if(std::rename(tmp_path.c_str(), m_path.c_str()))
+        raise_critical("Failed to replace trial cache file '{}'!", m_path);
+}
+} // namespace NeuralNet
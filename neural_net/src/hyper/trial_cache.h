@@ -0,0 +1,71 @@
+#pragma once
+#include "hyper/data.h"
+#include "net/net.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace NeuralNet {
+// monitored results of one sgd run
+struct TrialResult {
+    std::vector<float> test_costs, test_accuracies, eval_costs, eval_accuracies, train_costs, train_accuracies;
+    long long          learn_time       = 0;
+    size_t             epochs_to_target = 0;
+    long long          time_to_target   = 0;
+    LearnStatus        learn_status     = LearnStatus::Finished;
+};
+
+// fingerprints of training, test and eval data of a HyperParameter; 0 -> not given
+struct DataFingerprints {
+    uint64_t training = 0;
+    uint64_t test     = 0;
+    uint64_t eval     = 0;
+};
+
+// on-disk memoization of probes of the hyper surfer
+// key: topology including linear layers and pruning mask, cost, fingerprints of data, all hyper parameters and repetition
+// repetition tells runs of the same configuration with different initial weights apart
+// neither weights nor shuffling are seeded by it -> a cached result is one sample of its configuration, not a reproducible run
+// each store rewrites the json file via temporary file and rename <- a crash never leaves a broken cache
+// fingerprints get memoized per Data and recomputed when shape, buffer or a sample of values changes
+// changes of values outside of the sample go unnoticed
+class TrialCache {
+private:
+    struct MemoizedFingerprint {
+        uint64_t sample = 0;
+        uint64_t full   = 0;
+    };
+
+    std::string                                          m_path;
+    std::unordered_map<std::string, TrialResult>         m_results;
+    size_t                                               m_hits = 0;
+    std::unordered_map<const Data*, MemoizedFingerprint> m_fingerprints;
+
+    void write() const;
+    // memoized fingerprint; nullptr -> 0
+    uint64_t get_fingerprint(const Data* data);
+    std::string get_key(const Network& net, const HyperParameter& hy, size_t repetition);
+
+public:
+    // load path when it exists
+    explicit TrialCache(const std::string& path);
+
+    // true -> results of hy have been replaced by cached results
+    bool load(const Network& net, HyperParameter& hy, size_t repetition);
+    // store results of hy
+    void store(const Network& net, const HyperParameter& hy, size_t repetition);
+
+    size_t size() const { return m_results.size(); }
+    size_t hits() const { return m_hits; }
+};
+
+// FNV-1a hash of shape and all values
+uint64_t fingerprint(const Data& data);
+
+// human readable, unique for everything influencing the result of sgd except the evaluator
+std::string trial_key(const Network& net, const HyperParameter& hy, size_t repetition, const DataFingerprints& fingerprints);
+// computes fingerprints of all data of hy
+std::string trial_key(const Network& net, const HyperParameter& hy, size_t repetition);
+} // namespace NeuralNet
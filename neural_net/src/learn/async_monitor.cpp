@@ -0,0 +1,40 @@
+#include "async_monitor.h"
+
+#include "learn/eval.h"
+#include "pch.h"
+
+namespace NeuralNet {
+void AsyncMonitor::snapshot(const Network& net) {
+    Network& snapshot = m_snapshots[m_next];
+    std::copy(net.flat.begin(), net.flat.end(), snapshot.flat.begin());
+}
+
+void AsyncMonitor::start(const HyperParameter& hy, const TrainMonitor& train_monitor) {
+    if(busy())
+        raise_critical("Previous evaluation has to be collected before starting a new one.");
+    // results only contain this evaluation
+    m_results = hy;
+    m_results.reset_results();
+    m_train_monitor         = train_monitor;
+    const Network& snapshot = m_snapshots[m_next];
+    m_thread                = std::thread([this, &snapshot]() { update_learn_status(snapshot, m_results, m_train_monitor); });
+    m_next                  = 1 - m_next;
+}
+
+void AsyncMonitor::collect(HyperParameter& hy) {
+    if(!busy())
+        return;
+    m_thread.join();
+    auto append = [](std::vector<float>& to, const std::vector<float>& from) {
+        to.insert(to.end(), from.begin(), from.end());
+    };
+    append(hy.test_costs, m_results.test_costs);
+    append(hy.test_accuracies, m_results.test_accuracies);
+    append(hy.eval_costs, m_results.eval_costs);
+    append(hy.eval_accuracies, m_results.eval_accuracies);
+    append(hy.train_costs, m_results.train_costs);
+    append(hy.train_accuracies, m_results.train_accuracies);
+    append(hy.train_cost_intervals, m_results.train_cost_intervals);
+    append(hy.train_accuracy_intervals, m_results.train_accuracy_intervals);
+}
+} // namespace NeuralNet
@@ -0,0 +1,45 @@
+#pragma once
+#include "learn/eval.h"
+#include "net/net.h"
+
+#include <array>
+#include <thread>
+
+namespace NeuralNet {
+// evaluates snapshots of a network on a background thread while learning continues
+// double buffered: the next snapshot can be taken while the last one is still being evaluated
+// at most one evaluation runs at a time
+class AsyncMonitor {
+private:
+    std::array<Network, 2> m_snapshots;
+    // buffer receiving next snapshot
+    size_t m_next = 0;
+    // monitors of running evaluation, its results get appended to hy by collect
+    HyperParameter m_results;
+    // in flight metrics of snapshot's epoch
+    TrainMonitor m_train_monitor;
+    std::thread  m_thread;
+
+public:
+    // net gives the sizes of the snapshots
+    explicit AsyncMonitor(const Network& net)
+        : m_snapshots {net, net} {}
+    ~AsyncMonitor() {
+        if(m_thread.joinable())
+            m_thread.join();
+    }
+
+    // true -> evaluation is running or hasn't been collected yet
+    bool busy() const { return m_thread.joinable(); }
+
+    // copy weights and biases into free buffer without allocating
+    void snapshot(const Network& net);
+    // evaluate last snapshot on background thread using monitors of hy
+    // previous evaluation has to be collected first
+    void start(const HyperParameter& hy, const TrainMonitor& train_monitor);
+    // wait for running evaluation and append its results to hy
+    void collect(HyperParameter& hy);
+    // snapshot of last collected evaluation, valid until next start
+    const Network& evaluated() const { return m_snapshots[1 - m_next]; }
+};
+} // namespace NeuralNet
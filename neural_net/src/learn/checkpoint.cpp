@@ -0,0 +1,309 @@
+#include "checkpoint.h"
+
+#include "pch.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace NeuralNet {
+static constexpr char     s_magic[4] = {'N', 'N', 'C', 'P'};
+static constexpr uint32_t s_version  = 6;
+
+// append raw bytes of trivially copyable values
+class CheckpointOut {
+private:
+    std::string& m_buffer;
+
+public:
+    explicit CheckpointOut(std::string& buffer)
+        : m_buffer(buffer) {}
+
+    void bytes(const void* data, size_t size) {
+        if(size)
+            m_buffer.append(static_cast<const char*>(data), size);
+    }
+    template<typename T>
+    void value(T value) { bytes(&value, sizeof(T)); }
+    // with size
+    void floats(const float* data, size_t size) {
+        value<uint64_t>(size);
+        bytes(data, size * sizeof(float));
+    }
+    void floats(const std::vector<float>& vec) { floats(vec.data(), vec.size()); }
+    void floats(const arma::fvec& vec) { floats(vec.memptr(), vec.n_elem); }
+    void sizes(const std::vector<size_t>& vec) {
+        value<uint64_t>(vec.size());
+        for(size_t size: vec)
+            value<uint64_t>(size);
+    }
+    void string(const std::string& str) {
+        value<uint64_t>(str.size());
+        bytes(str.data(), str.size());
+    }
+};
+
+// read in the same order as written
+class CheckpointIn {
+private:
+    const std::string& m_buffer;
+    const std::string& m_path;
+    size_t             m_offset = 0;
+
+public:
+    CheckpointIn(const std::string& buffer, const std::string& path)
+        : m_buffer(buffer), m_path(path) {}
+
+    size_t remaining() const { return m_buffer.size() - m_offset; }
+
+    void bytes(void* data, size_t size) {
+        if(m_offset + size > m_buffer.size())
+            raise_critical("Checkpoint '{}' is truncated.", m_path);
+        if(size)
+            std::memcpy(data, m_buffer.data() + m_offset, size);
+        m_offset += size;
+    }
+    template<typename T>
+    T value() {
+        T value;
+        bytes(&value, sizeof(T));
+        return value;
+    }
+    // amount of elements of element_size bytes that follow
+    // checked before allocating <- a corrupt length mustn't cause huge allocations
+    size_t length(size_t element_size) {
+        uint64_t length = value<uint64_t>();
+        if(length > (m_buffer.size() - m_offset) / element_size)
+            raise_critical("Checkpoint '{}' is truncated.", m_path);
+        return length;
+    }
+    // size has to match
+    void floats(float* data, size_t size) {
+        if(value<uint64_t>() != size)
+            raise_critical("Checkpoint '{}' doesn't fit the network.", m_path);
+        bytes(data, size * sizeof(float));
+    }
+    void floats(std::vector<float>& vec) {
+        vec.resize(length(sizeof(float)));
+        bytes(vec.data(), vec.size() * sizeof(float));
+    }
+    void floats(arma::fvec& vec) {
+        vec.set_size(length(sizeof(float)));
+        bytes(vec.memptr(), vec.n_elem * sizeof(float));
+    }
+    void sizes(std::vector<size_t>& vec) {
+        vec.resize(length(sizeof(uint64_t)));
+        for(size_t& size: vec)
+            size = value<uint64_t>();
+    }
+    std::string string() {
+        std::string str(length(1), '\0');
+        bytes(str.data(), str.size());
+        return str;
+    }
+};
+
+std::string serialize_checkpoint(const Network& net, const HyperParameter& hy, const TrainingState& state) {
+    std::string   buffer;
+    CheckpointOut out(buffer);
+    out.bytes(s_magic, sizeof(s_magic));
+    out.value(s_version);
+
+    // topology and optimizer
+    out.value<uint64_t>(net.sizes.size());
+    for(size_t size: net.sizes)
+        out.value<uint64_t>(size);
+    for(size_t layer_idx = 0; layer_idx < net.num_layers; ++layer_idx)
+        out.value<uint8_t>(net.is_linear(layer_idx));
+    out.value(static_cast<uint8_t>(hy.optimizer_type));
+    // without results <- same for all checkpoints of a run
+    out.string(hy.to_str());
+
+    // parameters
+    const TrainingWorkspace& workspace = state.workspace;
+    out.floats(net.flat);
+    out.floats(workspace.velocity.flat);
+    out.floats(workspace.second_moment.flat);
+    out.value<uint64_t>(workspace.step);
+
+    // progress
+    out.value(state.eta);
+    out.value<uint64_t>(state.epoch);
+    out.value<uint64_t>(state.epochs_since_last_reduction);
+    out.value<uint64_t>(state.batches);
+    out.value<int64_t>(state.learn_time);
+    out.value(state.initial_check_cost);
+    out.value(workspace.check_cost.cost_sum);
+    out.value<uint64_t>(workspace.check_cost.n);
+    out.floats(state.best_flat);
+    out.value(state.best_score);
+    out.value<uint64_t>(state.best_epoch);
+    out.value<uint64_t>(state.epochs_since_best);
+    std::stringstream rng;
+    rng << state.rng;
+    out.string(rng.str());
+
+    // monitoring
+    const std::shared_ptr<const Data>& subsample = workspace.train_monitor.subsample;
+    out.value<uint8_t>(subsample != nullptr);
+    if(subsample) {
+        out.value<uint64_t>(subsample->get_x().n_rows);
+        out.value<uint64_t>(subsample->get_y().n_rows);
+        out.value<uint64_t>(subsample->get_x().n_cols);
+        // columns are contiguous
+        size_t n_elem = subsample->get_x().n_cols * (subsample->get_x().n_rows + subsample->get_y().n_rows);
+        out.floats(subsample->get_x().n_cols ? subsample->get_x_ptr(0) : nullptr, n_elem);
+    }
+    for(const std::vector<float>* results: {&hy.test_costs,
+                                            &hy.test_accuracies,
+                                            &hy.eval_costs,
+                                            &hy.eval_accuracies,
+                                            &hy.train_costs,
+                                            &hy.train_accuracies,
+                                            &hy.train_cost_intervals,
+                                            &hy.train_accuracy_intervals,
+                                            &hy.samples_per_second,
+                                            &hy.epoch_times,
+                                            &hy.monitor_times,
+                                            &hy.gflops})
+        out.floats(*results);
+    out.sizes(hy.rss_bytes);
+    out.sizes(hy.peak_rss_bytes);
+    out.value<uint64_t>(hy.epochs_to_target);
+    out.value<int64_t>(hy.time_to_target);
+    return buffer;
+}
+
+bool write_checkpoint(const std::string& buffer, const std::string& path) {
+    std::string   tmp_path = path + ".tmp";
+    std::ofstream file(tmp_path, std::ios::binary);
+    if(!file) {
+        log_learn_warn("Can't open checkpoint file '{}'!", tmp_path);
+        return false;
+    }
+    file.write(buffer.data(), buffer.size());
+    file.close();
+    if(!file) {
+        log_learn_warn("Failed to write checkpoint file '{}'!", tmp_path);
+        return false;
+    }
+#if defined(_WIN32) || defined(_WIN64)
+    // rename doesn't replace existing files
+    std::remove(path.c_str());
+#endif
+    if(std::rename(tmp_path.c_str(), path.c_str())) {
+        log_learn_warn("Failed to replace checkpoint file '{}'!", path);
+        return false;
+    }
+    return true;
+}
+
+bool load_checkpoint(Network& net, HyperParameter& hy, TrainingState& state, const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if(!file)
+        return false;
+    std::stringstream content;
+    content << file.rdbuf();
+    std::string  buffer = content.str();
+    CheckpointIn in(buffer, path);
+
+    char magic[sizeof(s_magic)];
+    in.bytes(magic, sizeof(magic));
+    if(std::memcmp(magic, s_magic, sizeof(s_magic)) || in.value<uint32_t>() != s_version)
+        raise_critical("'{}' isn't a checkpoint of this version.", path);
+
+    // topology and optimizer
+    std::vector<size_t> sizes;
+    in.sizes(sizes);
+    if(sizes != net.sizes)
+        raise_critical("Checkpoint '{}' doesn't fit {}.", path, net.to_str());
+    for(size_t layer_idx = 0; layer_idx < net.num_layers; ++layer_idx)
+        if(in.value<uint8_t>() != net.is_linear(layer_idx))
+            raise_critical("Checkpoint '{}' has other linear layers than {}.", path, net.to_str());
+    if(static_cast<OptimizerType>(in.value<uint8_t>()) != hy.optimizer_type)
+        raise_critical("Checkpoint '{}' has been written with another optimizer.", path);
+    std::string hy_str = in.string();
+    if(hy_str != hy.to_str())
+        raise_critical("Checkpoint '{}' has been written with other hyper parameters:\n{}", path, hy_str);
+
+    // parameters
+    // same sizes <- views stay valid
+    TrainingWorkspace& workspace = state.workspace;
+    in.floats(net.flat.memptr(), net.flat.n_elem);
+    in.floats(workspace.velocity.flat.memptr(), workspace.velocity.flat.n_elem);
+    in.floats(workspace.second_moment.flat.memptr(), workspace.second_moment.flat.n_elem);
+    workspace.step = in.value<uint64_t>();
+
+    // progress
+    state.eta                         = in.value<float>();
+    state.epoch                       = in.value<uint64_t>();
+    state.epochs_since_last_reduction = in.value<uint64_t>();
+    state.batches                     = in.value<uint64_t>();
+    state.learn_time                  = in.value<int64_t>();
+    state.initial_check_cost          = in.value<float>();
+    workspace.check_cost.cost_sum     = in.value<float>();
+    workspace.check_cost.n            = in.value<uint64_t>();
+    in.floats(state.best_flat);
+    state.best_score        = in.value<float>();
+    state.best_epoch        = in.value<uint64_t>();
+    state.epochs_since_best = in.value<uint64_t>();
+    std::stringstream rng(in.string());
+    rng >> state.rng;
+
+    // monitoring
+    if(in.value<uint8_t>()) {
+        size_t x_size = in.value<uint64_t>();
+        size_t y_size = in.value<uint64_t>();
+        size_t n_cols = in.value<uint64_t>();
+        // size of raw gets checked before allocating
+        if(x_size + y_size && n_cols > in.remaining() / sizeof(float) / (x_size + y_size))
+            raise_critical("Checkpoint '{}' is truncated.", path);
+        arma::fmat raw(x_size + y_size, n_cols);
+        in.floats(raw.memptr(), raw.n_elem);
+        workspace.train_monitor.subsample = std::make_shared<const Data>(raw, x_size, y_size);
+    } else
+        workspace.train_monitor.subsample = nullptr;
+    for(std::vector<float>* results: {&hy.test_costs,
+                                      &hy.test_accuracies,
+                                      &hy.eval_costs,
+                                      &hy.eval_accuracies,
+                                      &hy.train_costs,
+                                      &hy.train_accuracies,
+                                      &hy.train_cost_intervals,
+                                      &hy.train_accuracy_intervals,
+                                      &hy.samples_per_second,
+                                      &hy.epoch_times,
+                                      &hy.monitor_times,
+                                      &hy.gflops})
+        in.floats(*results);
+    in.sizes(hy.rss_bytes);
+    in.sizes(hy.peak_rss_bytes);
+    hy.epochs_to_target = in.value<uint64_t>();
+    hy.time_to_target   = in.value<int64_t>();
+    log_learn_general("Loaded checkpoint '{}' after {} epochs", path, state.epoch);
+    return true;
+}
+
+bool CheckpointWriter::due(const HyperParameter& hy, size_t epoch) const {
+    if(hy.checkpoint_epochs && epoch % hy.checkpoint_epochs == 0)
+        return true;
+    std::chrono::duration<float> since_last = std::chrono::steady_clock::now() - m_last;
+    return hy.checkpoint_seconds && since_last.count() >= hy.checkpoint_seconds;
+}
+
+void CheckpointWriter::write(const Network& net, const HyperParameter& hy, const TrainingState& state) {
+    wait();
+    m_buffer = serialize_checkpoint(net, hy, state);
+    m_last   = std::chrono::steady_clock::now();
+    m_thread = std::thread([this, epoch = state.epoch]() {
+        if(write_checkpoint(m_buffer, m_path))
+            log_learn_extra("Wrote checkpoint after {} epochs", epoch);
+    });
+}
+
+void CheckpointWriter::wait() {
+    if(m_thread.joinable())
+        m_thread.join();
+}
+} // namespace NeuralNet
@@ -0,0 +1,51 @@
+#pragma once
+#include "learn/workspace.h"
+#include "net/net.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+namespace NeuralNet {
+// binary snapshot of everything sgd needs to continue bit-exactly and the hyper parameters it was written with:
+// weights, biases, optimizer moments, eta, epoch counters, divergence checks, best weights,
+// shuffle rng, monitoring subsample and the results in hy
+// native byte order <- only meant to be read on the machine that wrote it
+std::string serialize_checkpoint(const Network& net, const HyperParameter& hy, const TrainingState& state);
+
+// write checkpoint via temporary file and rename <- a crash never leaves a broken checkpoint
+// return false on failure
+bool write_checkpoint(const std::string& buffer, const std::string& path);
+
+// restore checkpoint into net, results of hy and state
+// net and state have to be created with the sizes and optimizer of the checkpoint
+// continue with sgd(net, hy, state) and the same hyper parameters
+// checkpoints of other hyper parameters, as far as HyperParameter::to_str tells, are rejected
+// return false when there is no checkpoint at path
+bool load_checkpoint(Network& net, HyperParameter& hy, TrainingState& state, const std::string& path);
+
+// writes checkpoints on a background thread while learning continues
+// serializing happens on the calling thread and only copies memory
+// at most one write runs at a time
+class CheckpointWriter {
+private:
+    std::string m_path;
+    // checkpoint of running write
+    std::string m_buffer;
+    std::thread m_thread;
+    // time of last checkpoint, see HyperParameter::checkpoint_seconds
+    std::chrono::steady_clock::time_point m_last;
+
+public:
+    explicit CheckpointWriter(const std::string& path)
+        : m_path(path), m_last(std::chrono::steady_clock::now()) {}
+    ~CheckpointWriter() { wait(); }
+
+    // true when a checkpoint should be written after epoch finished epochs
+    bool due(const HyperParameter& hy, size_t epoch) const;
+    // previous write gets waited for
+    void write(const Network& net, const HyperParameter& hy, const TrainingState& state);
+    // wait for running write
+    void wait();
+};
+} // namespace NeuralNet
@@ -0,0 +1,378 @@
+#include "distributed.h"
+
+#include "pch.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+namespace NeuralNet {
+uint16_t to_half(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t abs  = bits & 0x7fffffff;
+    // infinity and nan
+    if(abs >= 0x7f800000)
+        return sign | 0x7c00 | (abs > 0x7f800000 ? 0x200 : 0);
+    // rounds to 65520 or more
+    if(abs >= 0x477ff000)
+        return sign | 0x7c00;
+    // subnormal half
+    if(abs < 0x38800000) {
+        // rounds to 0
+        if(abs <= 0x33000000)
+            return sign;
+        uint32_t mantissa  = (abs & 0x7fffff) | 0x800000;
+        uint32_t shift     = 126 - (abs >> 23);
+        uint32_t half      = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t midpoint  = 1u << (shift - 1);
+        if(remainder > midpoint || (remainder == midpoint && (half & 1)))
+            ++half;
+        return sign | half;
+    }
+    // rebias exponent from 127 to 15
+    uint32_t rebiased  = abs - 0x38000000;
+    uint32_t half      = rebiased >> 13;
+    uint32_t remainder = rebiased & 0x1fff;
+    // carry into exponent is correct
+    if(remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+        ++half;
+    return sign | half;
+}
+
+float from_half(uint16_t half) {
+    uint32_t sign     = static_cast<uint32_t>(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1f;
+    uint32_t mantissa = half & 0x3ff;
+    uint32_t bits;
+    if(exponent == 0x1f)
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    else if(exponent)
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    else {
+        // subnormal or 0
+        float value = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign ? -value : value;
+    }
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+// socket address of rank
+static socklen_t ring_address(const std::string& address, size_t rank, sockaddr_storage& storage) {
+    std::memset(&storage, 0, sizeof(storage));
+    if(address.rfind("tcp:", 0) == 0) {
+        sockaddr_in* in     = reinterpret_cast<sockaddr_in*>(&storage);
+        in->sin_family      = AF_INET;
+        in->sin_port        = htons(static_cast<uint16_t>(std::stoul(address.substr(4)) + rank));
+        in->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        return sizeof(sockaddr_in);
+    }
+    if(address.rfind("unix:", 0) == 0) {
+        std::string path = address.substr(5) + "." + std::to_string(rank);
+        sockaddr_un* un  = reinterpret_cast<sockaddr_un*>(&storage);
+        if(path.size() >= sizeof(un->sun_path))
+            raise_critical("Unix socket path '{}' is too long.", path);
+        un->sun_family = AF_UNIX;
+        std::strcpy(un->sun_path, path.c_str());
+        return sizeof(sockaddr_un);
+    }
+    raise_critical("Unknown ring address '{}'; use tcp:<port> or unix:<path>.", address);
+    return 0;
+}
+
+// non blocking with small messages sent right away
+static void configure_socket(int socket_fd, int family) {
+    if(family == AF_INET) {
+        int no_delay = 1;
+        setsockopt(socket_fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+    }
+#ifdef SO_NOSIGPIPE
+    int no_sigpipe = 1;
+    setsockopt(socket_fd, SOL_SOCKET, SO_NOSIGPIPE, &no_sigpipe, sizeof(no_sigpipe));
+#endif
+    fcntl(socket_fd, F_SETFL, fcntl(socket_fd, F_GETFL) | O_NONBLOCK);
+}
+#endif
+
+RingCommunicator::RingCommunicator(size_t rank, size_t world_size, const std::string& address, float timeout_seconds)
+    : m_rank(rank), m_world_size(world_size) {
+    if(!world_size || rank >= world_size)
+        raise_critical("Rank {} of {} is invalid.", rank, world_size);
+    if(world_size == 1)
+        return;
+#if defined(__unix__) || defined(__APPLE__)
+    sockaddr_storage own;
+    sockaddr_storage next;
+    socklen_t        own_length  = ring_address(address, m_rank, own);
+    socklen_t        next_length = ring_address(address, (m_rank + 1) % m_world_size, next);
+    int              family      = own.ss_family;
+
+    // listen before connecting <- connecting succeeds before previous rank accepts
+    int listener = socket(family, SOCK_STREAM, 0);
+    if(family == AF_UNIX)
+        unlink(reinterpret_cast<sockaddr_un*>(&own)->sun_path);
+    int reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if(listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&own), own_length) || listen(listener, 1))
+        raise_critical("Rank {} can't listen on '{}': {}", m_rank, address, std::strerror(errno));
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<float>(timeout_seconds);
+    while(m_next < 0) {
+        m_next = socket(family, SOCK_STREAM, 0);
+        if(!connect(m_next, reinterpret_cast<sockaddr*>(&next), next_length))
+            break;
+        close(m_next);
+        m_next = -1;
+        if(std::chrono::steady_clock::now() > deadline)
+            raise_critical("Rank {} can't connect to rank {}: {}", m_rank, (m_rank + 1) % m_world_size, std::strerror(errno));
+        // next rank hasn't started yet
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    pollfd pending = {listener, POLLIN, 0};
+    int    timeout = static_cast<int>(std::max(0.0f, std::chrono::duration<float, std::milli>(deadline - std::chrono::steady_clock::now()).count()));
+    if(poll(&pending, 1, timeout) <= 0 || (m_previous = accept(listener, nullptr, nullptr)) < 0)
+        raise_critical("Rank {} didn't get connected by rank {}.", m_rank, (m_rank + m_world_size - 1) % m_world_size);
+    close(listener);
+    if(family == AF_UNIX)
+        unlink(reinterpret_cast<sockaddr_un*>(&own)->sun_path);
+
+    configure_socket(m_next, family);
+    configure_socket(m_previous, family);
+    log_learn_general("Rank {} of {} joined ring at '{}'", m_rank, m_world_size, address);
+#else
+    (void)address;
+    (void)timeout_seconds;
+    raise_critical("Data parallel training requires posix sockets.");
+#endif
+}
+
+RingCommunicator::~RingCommunicator() {
+#if defined(__unix__) || defined(__APPLE__)
+    if(m_next >= 0)
+        close(m_next);
+    if(m_previous >= 0)
+        close(m_previous);
+#endif
+}
+
+void RingCommunicator::exchange(const void* send, size_t send_bytes, void* recv, size_t recv_bytes) {
+#if defined(__unix__) || defined(__APPLE__)
+#ifdef MSG_NOSIGNAL
+    constexpr int send_flags = MSG_NOSIGNAL;
+#else
+    constexpr int send_flags = 0;
+#endif
+    const char* send_ptr = static_cast<const char*>(send);
+    char*       recv_ptr = static_cast<char*>(recv);
+    size_t      sent     = 0;
+    size_t      received = 0;
+    while(sent < send_bytes || received < recv_bytes) {
+        // ignore finished directions
+        pollfd fds[2] = {{sent < send_bytes ? m_next : -1, POLLOUT, 0}, {received < recv_bytes ? m_previous : -1, POLLIN, 0}};
+        // crashed ranks close their sockets <- no timeout needed
+        if(poll(fds, 2, -1) < 0) {
+            if(errno == EINTR)
+                continue;
+            raise_critical("Rank {} can't poll its ring sockets: {}", m_rank, std::strerror(errno));
+        }
+        if(fds[0].revents) {
+            ssize_t count = ::send(m_next, send_ptr + sent, send_bytes - sent, send_flags);
+            if(count < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                raise_critical("Rank {} lost connection to rank {}: {}", m_rank, (m_rank + 1) % m_world_size, std::strerror(errno));
+            sent += std::max<ssize_t>(count, 0);
+        }
+        if(fds[1].revents) {
+            ssize_t count = ::recv(m_previous, recv_ptr + received, recv_bytes - received, 0);
+            if(count == 0 || (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+                raise_critical("Rank {} lost connection to rank {}.", m_rank, (m_rank + m_world_size - 1) % m_world_size);
+            received += std::max<ssize_t>(count, 0);
+        }
+    }
+#else
+    (void)send;
+    (void)send_bytes;
+    (void)recv;
+    (void)recv_bytes;
+#endif
+}
+
+void RingCommunicator::transfer(const float* send, size_t n_send, float* recv, size_t n_recv, bool fp16) {
+    if(!fp16) {
+        exchange(send, n_send * sizeof(float), recv, n_recv * sizeof(float));
+        return;
+    }
+    m_send_half.resize(n_send);
+    m_recv_half.resize(n_recv);
+    for(size_t i = 0; i < n_send; ++i)
+        m_send_half[i] = to_half(send[i]);
+    exchange(m_send_half.data(), n_send * sizeof(uint16_t), m_recv_half.data(), n_recv * sizeof(uint16_t));
+    for(size_t i = 0; i < n_recv; ++i)
+        recv[i] = from_half(m_recv_half[i]);
+}
+
+void RingCommunicator::all_reduce(float* values, size_t n, bool fp16) {
+    if(m_world_size == 1)
+        return;
+    // world_size chunks that differ in size by at most 1
+    auto chunk_begin = [&](size_t chunk) { return n * chunk / m_world_size; };
+    auto chunk_size  = [&](size_t chunk) { return chunk_begin(chunk + 1) - chunk_begin(chunk); };
+    m_recv.resize(n / m_world_size + 1);
+
+    // reduce-scatter <- afterwards this rank holds the sum of chunk rank + 1
+    for(size_t step = 0; step + 1 < m_world_size; ++step) {
+        size_t send_chunk = (m_rank + m_world_size - step) % m_world_size;
+        size_t recv_chunk = (m_rank + m_world_size - step - 1) % m_world_size;
+        transfer(values + chunk_begin(send_chunk), chunk_size(send_chunk), m_recv.data(), chunk_size(recv_chunk), fp16);
+        float* target = values + chunk_begin(recv_chunk);
+        for(size_t i = 0; i < chunk_size(recv_chunk); ++i)
+            target[i] += m_recv[i];
+    }
+    // round like the receivers do <- identical on all ranks
+    size_t own_chunk = (m_rank + 1) % m_world_size;
+    if(fp16)
+        for(size_t i = chunk_begin(own_chunk); i < chunk_begin(own_chunk + 1); ++i)
+            values[i] = from_half(to_half(values[i]));
+
+    // all-gather
+    for(size_t step = 0; step + 1 < m_world_size; ++step) {
+        size_t send_chunk = (m_rank + 1 + m_world_size - step) % m_world_size;
+        size_t recv_chunk = (m_rank + m_world_size - step) % m_world_size;
+        transfer(values + chunk_begin(send_chunk), chunk_size(send_chunk), values + chunk_begin(recv_chunk), chunk_size(recv_chunk), fp16);
+    }
+}
+
+void RingCommunicator::broadcast_bytes(void* values, size_t bytes) {
+    if(m_world_size == 1)
+        return;
+    // pass along the ring from rank 0 to the last rank
+    if(m_rank)
+        exchange(nullptr, 0, values, bytes);
+    if(m_rank + 1 < m_world_size)
+        exchange(values, bytes, nullptr, 0);
+}
+
+void RingCommunicator::broadcast(float* values, size_t n) {
+    broadcast_bytes(values, n * sizeof(float));
+}
+
+void RingCommunicator::broadcast(uint64_t* values, size_t n) {
+    broadcast_bytes(values, n * sizeof(uint64_t));
+}
+
+bool RingCommunicator::any(bool value) {
+    float count = value ? 1.0f : 0.0f;
+    all_reduce(&count, 1);
+    return count > 0.0f;
+}
+
+std::unique_ptr<RingCommunicator> RingCommunicator::from_env() {
+    const char* rank       = std::getenv("NEURAL_NET_RANK");
+    const char* world_size = std::getenv("NEURAL_NET_WORLD_SIZE");
+    const char* address    = std::getenv("NEURAL_NET_RING_ADDRESS");
+    if(!rank || !world_size || !address)
+        return nullptr;
+    return std::make_unique<RingCommunicator>(std::stoul(rank), std::stoul(world_size), address);
+}
+
+std::vector<int> launch_local_workers(char* argv[], size_t world_size, const std::string& address) {
+    std::vector<int> workers;
+    if(world_size < 2 || std::getenv("NEURAL_NET_RANK"))
+        return workers;
+#if defined(__unix__) || defined(__APPLE__)
+    setenv("NEURAL_NET_RANK", "0", 1);
+    setenv("NEURAL_NET_WORLD_SIZE", std::to_string(world_size).c_str(), 1);
+    setenv("NEURAL_NET_RING_ADDRESS", address.c_str(), 1);
+    for(size_t rank = 1; rank < world_size; ++rank) {
+        // build environment before forking <- only exec in child
+        std::vector<std::string> env_strings;
+        for(char** var = environ; *var; ++var)
+            if(std::strncmp(*var, "NEURAL_NET_RANK=", 16))
+                env_strings.emplace_back(*var);
+        env_strings.push_back("NEURAL_NET_RANK=" + std::to_string(rank));
+        std::vector<char*> env;
+        for(std::string& var: env_strings)
+            env.push_back(var.data());
+        env.push_back(nullptr);
+
+        pid_t pid = fork();
+        if(pid < 0)
+            raise_critical("Can't start worker {}: {}", rank, std::strerror(errno));
+        if(!pid) {
+#if defined(__linux__)
+            execve("/proc/self/exe", argv, env.data());
+#else
+            environ = env.data();
+            execvp(argv[0], argv);
+#endif
+            _exit(127);
+        }
+        workers.push_back(pid);
+    }
+    log_learn_general("Started {} local workers at '{}'", workers.size(), address);
+#else
+    (void)argv;
+    (void)address;
+    raise_critical("Local workers require posix.");
+#endif
+    return workers;
+}
+
+bool wait_for_workers(const std::vector<int>& workers) {
+    bool success = true;
+#if defined(__unix__) || defined(__APPLE__)
+    for(int worker: workers) {
+        int status = 0;
+        if(waitpid(worker, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status)) {
+            log_learn_error("Worker {} failed", worker);
+            success = false;
+        }
+    }
+#else
+    (void)workers;
+#endif
+    return success;
+}
+
+void check_distributed(const HyperParameter& hy) {
+    RingCommunicator& communicator = *hy.communicator;
+    size_t            world_size   = communicator.get_world_size();
+    if(hy.mini_batch_size % world_size)
+        raise_critical("mini_batch_size {} has to be divisible by the world size {}.", hy.mini_batch_size, world_size);
+    if(hy.async_monitoring)
+        raise_critical("Data parallel training doesn't support asynchronous monitoring.");
+    if(!hy.checkpoint_path.empty())
+        raise_critical("Data parallel training doesn't support checkpoints.");
+    // decisions have to be the same on all ranks <- only metrics of data all ranks share
+    if(hy.best_weights_metric == StopMetric::TrainCost || hy.best_weights_metric == StopMetric::TrainAccuracy)
+        raise_critical("Data parallel training can't keep the best weights by a metric of the training shard.");
+
+    // same amount of mini batches on all ranks
+    // exact integers <- float sums lose counts beyond 2^24
+    uint64_t n_first = hy.training_data->get_x().n_cols;
+    communicator.broadcast(&n_first, 1);
+    if(communicator.any(n_first != hy.training_data->get_x().n_cols))
+        raise_critical("All ranks need shards of the same size, see Data::get_shard.");
+}
+} // namespace NeuralNet
@@ -0,0 +1,76 @@
+#pragma once
+#include "net/net.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace NeuralNet {
+// one of world_size processes connected in a ring; each sends to rank + 1 and receives from rank - 1
+// address of the ring:
+//      "tcp:<port>"  -> rank r listens on 127.0.0.1 at port + r
+//      "unix:<path>" -> rank r listens on the unix socket <path>.<r>
+// posix only
+class RingCommunicator {
+private:
+    size_t m_rank;
+    size_t m_world_size;
+    // to rank + 1
+    int m_next = -1;
+    // from rank - 1
+    int m_previous = -1;
+
+    // chunks in flight
+    std::vector<float>    m_recv;
+    std::vector<uint16_t> m_send_half;
+    std::vector<uint16_t> m_recv_half;
+
+    // send to next and receive from previous at the same time <- rings deadlock otherwise
+    void exchange(const void* send, size_t send_bytes, void* recv, size_t recv_bytes);
+    // fp16 -> convert on the wire
+    void transfer(const float* send, size_t n_send, float* recv, size_t n_recv, bool fp16);
+    // bytes of rank 0 on all ranks
+    void broadcast_bytes(void* values, size_t bytes);
+
+public:
+    // blocks until the ring is closed; connecting gives up after timeout_seconds
+    RingCommunicator(size_t rank, size_t world_size, const std::string& address, float timeout_seconds = 60.0f);
+    ~RingCommunicator();
+    RingCommunicator(const RingCommunicator&) = delete;
+    RingCommunicator& operator=(const RingCommunicator&) = delete;
+
+    size_t get_rank() const { return m_rank; }
+    size_t get_world_size() const { return m_world_size; }
+
+    // sum values of all ranks in place with reduce-scatter and all-gather
+    // all ranks end with bitwise identical values
+    // fp16 -> send half precision, halves traffic; sums beyond 65504 become infinite
+    void all_reduce(float* values, size_t n, bool fp16 = false);
+    // values of rank 0 on all ranks
+    void broadcast(float* values, size_t n);
+    void broadcast(uint64_t* values, size_t n);
+    // true on all ranks when true on any
+    bool any(bool value);
+
+    // rank, world size and address from NEURAL_NET_RANK, NEURAL_NET_WORLD_SIZE and NEURAL_NET_RING_ADDRESS
+    // nullptr -> not started as part of a ring
+    static std::unique_ptr<RingCommunicator> from_env();
+};
+
+// start ranks 1 to world_size - 1 as copies of this executable with the same arguments
+// this process becomes rank 0; connect all of them with RingCommunicator::from_env
+// does nothing in started workers or for world_size 1
+// returns process ids of workers
+std::vector<int> launch_local_workers(char* argv[], size_t world_size, const std::string& address);
+// return true when all workers exited successfully
+bool wait_for_workers(const std::vector<int>& workers);
+
+// requirements of data parallel training, see HyperParameter::communicator
+// checks that the shards of all ranks have the same size
+void check_distributed(const HyperParameter& hy);
+
+// float to IEEE 754 half precision with round to nearest even and back
+uint16_t to_half(float value);
+float    from_half(uint16_t half);
+} // namespace NeuralNet
@@ -28,51 +28,89 @@ float total_cost(const Network& net, const Data* data, float lambda_l1, float la
     }
     // take average
     cost /= data->get_x().n_cols;
+    return cost + regularization_cost(net, lambda_l1, lambda_l2, data->get_x().n_cols);
+}
 
+float regularization_cost(const Network& net, float lambda_l1, float lambda_l2, size_t n) {
+    float cost = 0.0f;
+    // all weights are in front of all biases
+    const arma::subview_col<float> weights = net.flat.head(net.n_weights());
     // L1 regularization
     if(lambda_l1) {
         // sum of absolute of all weights
-        float sum = 0.0f;
-        for(const arma::fmat& w: net.weights) {
-            sum += arma::accu(arma::abs(w));
-        }
-        cost += (lambda_l1 / data->get_x().n_cols) * sum;
+        float sum = arma::accu(arma::abs(weights));
+        cost += (lambda_l1 / n) * sum;
     }
     // L2 regularization
     if(lambda_l2) {
-        // sum of squares of all weights
-        float sum = 0.0f;
-        for(const arma::fmat& w: net.weights) {
-            // euclidean norm:
-            // || a b ||
-            // || c d ||2 = sqrt(a**2 + b**2 + c**2 + d**2)
-            float norm = arma::norm(w);
-            // the square root has to be removed
-            sum += norm * norm;
-        }
-        cost += 0.5f * (lambda_l2 / data->get_x().n_cols) * sum;
+        // euclidean norm:
+        // || a b ||
+        // || c d ||2 = sqrt(a**2 + b**2 + c**2 + d**2)
+        float norm = arma::norm(weights);
+        // sum of squares of all weights <- the square root has to be removed
+        float sum = norm * norm;
+        cost += 0.5f * (lambda_l2 / n) * sum;
     }
     return cost;
 }
 
+void InFlightMetrics::add(const Network& net, const arma::fmat& a, const arma::subview<float>& y) {
+    for(size_t i = 0; i < a.n_cols; ++i) {
+        arma::fvec a_i = a.col(i);
+        arma::fvec y_i = y.col(i);
+        if(cost)
+            cost_sum += net.cost->fn(a_i, y_i);
+        if(accuracy)
+            accuracy_sum += net.evaluator(y_i, a_i);
+    }
+    n += a.n_cols;
+}
+
+TrainMonitor::TrainMonitor(const HyperParameter& hy) {
+    in_flight.cost     = hy.monitor_train_cost && hy.train_cost_mode == MonitorMode::InFlight;
+    in_flight.accuracy = hy.monitor_train_accuracy && hy.train_accuracy_mode == MonitorMode::InFlight;
+    bool use_subsample = (hy.monitor_train_cost && hy.train_cost_mode == MonitorMode::Subsample) ||
+                         (hy.monitor_train_accuracy && hy.train_accuracy_mode == MonitorMode::Subsample);
+    if(use_subsample && hy.training_data != nullptr) {
+        size_t n  = hy.training_data->get_x().n_cols;
+        subsample = std::make_shared<const Data>(hy.training_data->get_shuffled().get_sub(0, std::min(n, hy.monitor_subsample_size)));
+    }
+}
+
+// mean of values and half width of its 95% confidence interval
+static void mean_interval(const std::vector<float>& values, float& mean, float& interval) {
+    mean = 0.0f;
+    for(float value: values)
+        mean += value;
+    mean /= values.size();
+    float variance = 0.0f;
+    for(float value: values)
+        variance += (value - mean) * (value - mean);
+    // sample variance
+    variance /= values.size() > 1 ? values.size() - 1 : 1;
+    interval = 1.96f * std::sqrt(variance / values.size());
+}
+
 arma::fmat feedforward(const Network& net, arma::fmat a) {
     // loop over each layer
     for(size_t left_layer_idx = 0; left_layer_idx < net.num_layers - 1; ++left_layer_idx) {
         //                                 <- actually of right layer
         arma::fmat biases_mat = net.biases[left_layer_idx] * arma::fmat(1, a.n_cols, arma::fill::ones);
-        a                     = sigmoid(net.weights[left_layer_idx] * a + biases_mat);
+        a                     = net.activate(left_layer_idx + 1, net.weights[left_layer_idx] * a + biases_mat);
     }
     return a;
 }
 
-void update_learn_status(const Network& net, HyperParameter& hy) {
+void update_learn_status(const Network& net, HyperParameter& hy, const TrainMonitor& train_monitor) {
     // evaluate status
     if(hy.monitor_test_cost) {
+        NN_PROFILE_SCOPE(ProfilePhase::MonitorTestCost, 0);
         float cost = total_cost(net, hy.test_data, hy.lambda_l1, hy.lambda_l2);
         hy.test_costs.push_back(cost);
         log_learn_extra("\tCost on test data: {}", cost);
     }
     if(hy.monitor_test_accuracy) {
+        NN_PROFILE_SCOPE(ProfilePhase::MonitorTestAccuracy, 0);
         float accuracy = total_accuracy(net, hy.test_data, net.evaluator);
         hy.test_accuracies.push_back(accuracy);
         size_t n_test = hy.test_data->get_y().n_cols;
@@ -80,27 +118,87 @@ void update_learn_status(const Network& net, HyperParameter& hy) {
     }
 
     if(hy.monitor_eval_cost) {
+        NN_PROFILE_SCOPE(ProfilePhase::MonitorEvalCost, 0);
         float cost = total_cost(net, hy.eval_data, hy.lambda_l1, hy.lambda_l2);
         hy.eval_costs.push_back(cost);
         log_learn_extra("\tCost on eval data: {}", cost);
     }
     if(hy.monitor_eval_accuracy) {
+        NN_PROFILE_SCOPE(ProfilePhase::MonitorEvalAccuracy, 0);
         float accuracy = total_accuracy(net, hy.eval_data, net.evaluator);
         hy.eval_accuracies.push_back(accuracy);
         size_t n_eval = hy.eval_data->get_y().n_cols;
         log_learn_extra("\tAccuracy on eval data: {} / {}", accuracy, n_eval);
     }
 
+    size_t n_train = hy.training_data->get_x().n_cols;
     if(hy.monitor_train_cost) {
-        float cost = total_cost(net, hy.training_data, hy.lambda_l1, hy.lambda_l2);
+        NN_PROFILE_SCOPE(ProfilePhase::MonitorTrainCost, 0);
+        float cost = 0.0f;
+        switch(hy.train_cost_mode) {
+        case MonitorMode::Full:
+            cost = total_cost(net, hy.training_data, hy.lambda_l1, hy.lambda_l2);
+            log_learn_extra("\tCost on training data: {}", cost);
+            break;
+        case MonitorMode::Subsample: {
+            std::vector<float> costs;
+            for(size_t i = 0; i < train_monitor.subsample->get_x().n_cols; ++i) {
+                arma::fvec a = feedforward(net, train_monitor.subsample->get_x().col(i));
+                costs.push_back(net.cost->fn(a, train_monitor.subsample->get_y().col(i)));
+            }
+            float interval;
+            mean_interval(costs, cost, interval);
+            // regularization doesn't depend on data
+            cost += regularization_cost(net, hy.lambda_l1, hy.lambda_l2, n_train);
+            hy.train_cost_intervals.push_back(interval);
+            log_learn_extra("\tCost on training data: {} +- {} (subsample of {})", cost, interval, costs.size());
+            break;
+        }
+        case MonitorMode::InFlight:
+            if(!train_monitor.in_flight.n)
+                raise_critical("In flight monitoring requires metrics accumulated by backprop.");
+            cost = train_monitor.in_flight.cost_sum / train_monitor.in_flight.n +
+                   regularization_cost(net, hy.lambda_l1, hy.lambda_l2, n_train);
+            log_learn_extra("\tCost on training data: {} (in flight)", cost);
+            break;
+        }
         hy.train_costs.push_back(cost);
-        log_learn_extra("\tCost on training data: {}", cost);
     }
     if(hy.monitor_train_accuracy) {
-        float accuracy = total_accuracy(net, hy.training_data, net.evaluator);
+        NN_PROFILE_SCOPE(ProfilePhase::MonitorTrainAccuracy, 0);
+        float accuracy = 0.0f;
+        switch(hy.train_accuracy_mode) {
+        case MonitorMode::Full:
+            accuracy = total_accuracy(net, hy.training_data, net.evaluator);
+            log_learn_extra("\tAccuracy on training data: {} / {}", accuracy, n_train);
+            break;
+        case MonitorMode::Subsample: {
+            std::vector<float> correct;
+            for(size_t i = 0; i < train_monitor.subsample->get_x().n_cols; ++i) {
+                arma::fvec a = feedforward(net, train_monitor.subsample->get_x().col(i));
+                correct.push_back(net.evaluator(train_monitor.subsample->get_y().col(i), a));
+            }
+            float mean, interval;
+            mean_interval(correct, mean, interval);
+            // scale to size of training data
+            accuracy = mean * n_train;
+            hy.train_accuracy_intervals.push_back(interval * n_train);
+            log_learn_extra("\tAccuracy on training data: {} +- {} / {} (subsample of {})", accuracy,
+                            interval * n_train, n_train, correct.size());
+            break;
+        }
+        case MonitorMode::InFlight:
+            if(!train_monitor.in_flight.n)
+                raise_critical("In flight monitoring requires metrics accumulated by backprop.");
+            accuracy = train_monitor.in_flight.accuracy_sum * n_train / train_monitor.in_flight.n;
+            log_learn_extra("\tAccuracy on training data: {} / {} (in flight)", accuracy, n_train);
+            break;
+        }
         hy.train_accuracies.push_back(accuracy);
-        size_t n_train = hy.training_data->get_x().n_cols;
-        log_learn_extra("\tAccuracy on training data: {} / {}", accuracy, n_train);
     }
 }
+
+void update_learn_status(const Network& net, HyperParameter& hy) {
+    update_learn_status(net, hy, TrainMonitor(hy));
+}
 } // namespace NeuralNet
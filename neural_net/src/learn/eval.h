@@ -2,6 +2,8 @@
 #include "hyper/data.h"
 #include "net/net.h"
 
+#include <memory>
+
 namespace NeuralNet {
 // return number of correct results of neural network
 // neuron in final layer with highest activation determines result
@@ -15,6 +17,42 @@ float total_cost(const Network& net, const Data* data, float lambda_l1, float la
 // a gets changed
 arma::fmat feedforward(const Network& net, arma::fmat a);
 
+// sums over data sets seen during the current epoch, see MonitorMode::InFlight
+struct InFlightMetrics {
+    bool   cost         = false;
+    bool   accuracy     = false;
+    float  cost_sum     = 0.0f;
+    float  accuracy_sum = 0.0f;
+    size_t n            = 0;
+
+    void reset() {
+        cost_sum     = 0.0f;
+        accuracy_sum = 0.0f;
+        n            = 0;
+    }
+
+    // add output activations a with desired output y, one column per data set
+    void add(const Network& net, const arma::fmat& a, const arma::subview<float>& y);
+};
+
+// cheaper sources of training metrics than full passes over training data
+struct TrainMonitor {
+    // fixed random subset of training data for MonitorMode::Subsample
+    std::shared_ptr<const Data> subsample;
+    InFlightMetrics             in_flight;
+
+    TrainMonitor() = default;
+    // draw subsample when needed
+    explicit TrainMonitor(const HyperParameter& hy);
+};
+
+// sum of L1 and L2 regularization terms of cost for n data sets
+float regularization_cost(const Network& net, float lambda_l1, float lambda_l2, size_t n);
+
 // when full_run -> e.g. print current epoch
+// train metrics depend on train_cost_mode and train_accuracy_mode
+void update_learn_status(const Network& net, HyperParameter& hy, const TrainMonitor& train_monitor);
+
+// without in flight metrics; draws a new subsample for each call
 void update_learn_status(const Network& net, HyperParameter& hy);
 } // namespace NeuralNet
@@ -0,0 +1,211 @@
+#pragma once
+#include "hyper/data.h"
+#include "learn/eval.h"
+#include "learn/learn.h"
+#include "net/fixed_net.h"
+
+#include <memory>
+
+namespace NeuralNet {
+// everything needed to train a fixed network
+// lives on the heap once per training, the network itself stays inline
+template<size_t... Sizes>
+struct FixedWorkspace {
+    using Fixed = FixedNetwork<Sizes...>;
+    // sums of gradients of current mini batch
+    alignas(32) std::array<float, Fixed::n_weights> nabla_w {};
+    alignas(32) std::array<float, Fixed::n_biases> nabla_b {};
+    // used for momentum-based gradient descent
+    alignas(32) std::array<float, Fixed::n_weights> vel_w {};
+    alignas(32) std::array<float, Fixed::n_biases> vel_b {};
+    // of current data set
+    alignas(32) std::array<float, Fixed::n_neurons> activations {};
+    alignas(32) std::array<float, Fixed::n_biases> zs {};
+    alignas(32) std::array<float, Fixed::n_biases> errors {};
+};
+
+// add gradient of weights between Layer and Layer + 1 to nabla_w
+// error of layer Layer + 1 has to be calculated already
+// calculate error of layer Layer (BP2), unless it is the input layer
+template<size_t Layer, size_t... Sizes>
+inline void fixed_backward_layer(const FixedNetwork<Sizes...>& net, FixedWorkspace<Sizes...>& ws) {
+    using Fixed          = FixedNetwork<Sizes...>;
+    constexpr size_t in  = Fixed::sizes[Layer];
+    constexpr size_t out = Fixed::sizes[Layer + 1];
+    const float*     w   = net.weights.data() + Fixed::weight_offset(Layer);
+    float*           n_w = ws.nabla_w.data() + Fixed::weight_offset(Layer);
+    const float*     a   = ws.activations.data() + Fixed::neuron_offset(Layer);
+    const float*     err = ws.errors.data() + Fixed::bias_offset(Layer + 1);
+
+    // BP4
+    for(size_t k = 0; k < in; ++k) {
+        const float a_k   = a[k];
+        float*      n_w_k = n_w + k * out;
+        for(size_t j = 0; j < out; ++j)
+            n_w_k[j] += err[j] * a_k;
+    }
+    if constexpr(Layer > 0) {
+        // BP2
+        float* left_err = ws.errors.data() + Fixed::bias_offset(Layer);
+        for(size_t k = 0; k < in; ++k) {
+            const float* w_k = w + k * out;
+            float        sum = 0.0f;
+            for(size_t j = 0; j < out; ++j)
+                sum += w_k[j] * err[j];
+            // sigmoid_prime(z) = a * (1 - a)
+            left_err[k] = sum * a[k] * (1.0f - a[k]);
+        }
+        // BP3
+        float* n_b = ws.nabla_b.data() + Fixed::bias_offset(Layer);
+        for(size_t k = 0; k < in; ++k)
+            n_b[k] += left_err[k];
+    }
+}
+
+template<size_t... Sizes, size_t... Layers>
+inline void fixed_backward(const FixedNetwork<Sizes...>& net, FixedWorkspace<Sizes...>& ws, std::index_sequence<Layers...>) {
+    // from right to left
+    (fixed_backward_layer<sizeof...(Layers) - 1 - Layers>(net, ws), ...);
+}
+
+// add gradient of single data set to nabla_w and nabla_b
+template<size_t... Sizes>
+inline void fixed_backprop(const FixedNetwork<Sizes...>& net, FixedWorkspace<Sizes...>& ws, const float* x, const float* y) {
+    using Fixed            = FixedNetwork<Sizes...>;
+    constexpr size_t n_out = Fixed::sizes[Fixed::num_layers - 1];
+
+    std::copy(x, x + Fixed::sizes[0], ws.activations.begin());
+    fixed_feedforward(net, ws.zs.data(), ws.activations.data());
+
+    // calculate error for last layer (BP1)
+    const float* a   = ws.activations.data() + Fixed::neuron_offset(Fixed::num_layers - 1);
+    float*       err = ws.errors.data() + Fixed::bias_offset(Fixed::num_layers - 1);
+    if(net.cost_type == FixedCostType::CrossEntropy)
+        for(size_t j = 0; j < n_out; ++j)
+            err[j] = a[j] - y[j];
+    else
+        for(size_t j = 0; j < n_out; ++j)
+            err[j] = (a[j] - y[j]) * a[j] * (1.0f - a[j]);
+    // BP3
+    float* n_b = ws.nabla_b.data() + Fixed::bias_offset(Fixed::num_layers - 1);
+    for(size_t j = 0; j < n_out; ++j)
+        n_b[j] += err[j];
+
+    fixed_backward(net, ws, std::make_index_sequence<Fixed::num_layers - 1>());
+}
+
+// same update rule as update_mini_batch
+// length data sets starting at offset
+template<size_t... Sizes>
+void fixed_update_mini_batch(FixedNetwork<Sizes...>&  net,
+                             FixedWorkspace<Sizes...>& ws,
+                             const Data&               data,
+                             size_t                    offset,
+                             size_t                    length,
+                             float                     eta,
+                             float                     mu,
+                             float                     lambda_l1,
+                             float                     lambda_l2,
+                             size_t                    n) {
+    using Fixed = FixedNetwork<Sizes...>;
+    ws.nabla_w.fill(0.0f);
+    ws.nabla_b.fill(0.0f);
+    for(size_t idx = offset; idx < offset + length; ++idx)
+        fixed_backprop(net, ws, data.get_x_ptr(idx), data.get_y_ptr(idx));
+
+    float eta_over_length  = eta / length;
+    float lambda_l1_over_n = lambda_l1 / n;
+    float lambda_l2_over_n = lambda_l2 / n;
+    float l1_step          = eta * lambda_l1_over_n;
+    float l2_scale         = 1.0f - eta * lambda_l2_over_n;
+    // ignore post process layer
+    size_t n_w = net.post_process ? Fixed::weight_offset(Fixed::num_layers - 2) : Fixed::n_weights;
+    size_t n_b = net.post_process ? Fixed::bias_offset(Fixed::num_layers - 1) : Fixed::n_biases;
+    for(size_t i = 0; i < n_w; ++i) {
+        float w    = net.weights[i];
+        float sign = static_cast<float>((w > 0.0f) - (w < 0.0f));
+        float v    = ws.vel_w[i];
+        v -= l1_step * sign;
+        v *= l2_scale;
+        v *= mu;
+        v -= eta_over_length * ws.nabla_w[i];
+        ws.vel_w[i]    = v;
+        net.weights[i] = w + v;
+    }
+    for(size_t i = 0; i < n_b; ++i) {
+        float v = ws.vel_b[i] * mu;
+        v -= eta_over_length * ws.nabla_b[i];
+        ws.vel_b[i] = v;
+        net.biases[i] += v;
+    }
+}
+
+// stochastic gradient descent, equivalent to sgd with a dynamic network
+// only momentum optimizer is supported, weights of last epoch are kept
+// divergence check only looks for non-finite weights after each epoch
+// monitoring converts to a dynamic network once per epoch
+template<size_t... Sizes>
+void sgd(FixedNetwork<Sizes...>& net, HyperParameter& hy) {
+    // info block
+    log_learn_general("Using stochastic gradient descent on fixed network:\n{}", hy.to_str());
+
+    auto begin = std::chrono::high_resolution_clock::now();
+    hy.is_valid();
+    if(hy.optimizer_type != OptimizerType::Momentum)
+        raise_critical("Fixed networks only support the momentum optimizer.");
+    if((hy.monitor_train_cost && hy.train_cost_mode == MonitorMode::InFlight) ||
+       (hy.monitor_train_accuracy && hy.train_accuracy_mode == MonitorMode::InFlight))
+        raise_critical("Fixed networks don't support in flight monitoring.");
+    if(hy.best_weights_metric != StopMetric::None || hy.patience)
+        raise_critical("Fixed networks don't support restoring best weights or patience.");
+    if(!hy.checkpoint_path.empty())
+        raise_critical("Fixed networks don't support checkpoints.");
+    // would train on the shard of this rank only
+    if(hy.communicator)
+        raise_critical("Fixed networks don't support data parallel training.");
+    if(hy.async_monitoring || !hy.metrics_path.empty() || hy.profile)
+        raise_critical("Fixed networks don't support asynchronous monitoring, metrics files or profiling.");
+    if(hy.divergence_factor)
+        raise_critical("Fixed networks only check for non-finite weights, divergence_factor has to be 0.");
+    hy.learn_status = LearnStatus::Finished;
+    // current eta may get changed over time
+    float eta = hy.init_eta;
+    // don't divide by 0
+    float  stop_eta = hy.stop_eta_fraction ? hy.init_eta / hy.stop_eta_fraction : 0;
+    size_t n        = hy.training_data->get_x().n_cols;
+
+    // too big for the stack with wide layers
+    std::unique_ptr<FixedWorkspace<Sizes...>> ws = std::make_unique<FixedWorkspace<Sizes...>>();
+    Network                                   monitor_net;
+    // same subsample in every epoch
+    TrainMonitor train_monitor(hy);
+
+    size_t epoch = 0;
+    // gets reset after reducing eta
+    size_t epochs_since_last_reduction = 0;
+    // go over epochs
+    bool quit = false;
+    while(!quit) {
+        // learn
+        Data this_training_data = hy.training_data->get_shuffled();
+        // go over mini batches
+        for(size_t offset = 0; offset < n; offset += hy.mini_batch_size) {
+            // make last batch smaller if necessary
+            size_t length = offset + hy.mini_batch_size >= n ? n - offset : hy.mini_batch_size;
+            float batch_eta = scheduled_eta(hy, eta, epoch + static_cast<float>(offset) / n);
+            fixed_update_mini_batch(net, *ws, this_training_data, offset, length, batch_eta, hy.mu, hy.lambda_l1, hy.lambda_l2, n);
+        }
+        log_learn_extra("Epoch {} training complete", epoch);
+        to_network(net, monitor_net);
+        // once per epoch <- no gradients outside of workspace
+        if(hy.divergence_check_interval && !monitor_net.flat.is_finite()) {
+            log_learn_warn("Non-finite weights after {} epochs; learning aborted", epoch + 1);
+            hy.learn_status = LearnStatus::Diverged;
+            break;
+        }
+        update_learn_status(monitor_net, hy, train_monitor);
+        quit = end_epoch(hy, eta, stop_eta, epoch, epochs_since_last_reduction, begin);
+    }
+    report_learn_time(hy, begin);
+}
+} // namespace NeuralNet
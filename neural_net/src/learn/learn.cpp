@@ -1,97 +1,430 @@
 #include "learn.h"
 
+#include "learn/async_monitor.h"
+#include "learn/checkpoint.h"
+#include "learn/distributed.h"
 #include "learn/eval.h"
+#include "main/memory.h"
+#include "net/pruning.h"
 #include "pch.h"
 
+#include <fstream>
+
 namespace NeuralNet {
 void sgd(Network& net, HyperParameter& hy) {
+    // gradients and optimizer state start at all 0
+    TrainingState state(net, hy);
+    sgd(net, hy, state);
+}
+
+// amount of processes training together
+static size_t world_size(const HyperParameter& hy) {
+    return hy.communicator ? hy.communicator->get_world_size() : 1;
+}
+
+// shuffle training data and update for each mini batch
+// epoch gives progress of time based schedules
+// return true on divergence
+static bool train_epoch(Network& net, const HyperParameter& hy, TrainingState& state, size_t epoch) {
+    size_t n = hy.training_data->get_x().n_cols;
+    // each rank takes its part of the global mini batch
+    size_t mini_batch_size = hy.mini_batch_size / world_size(hy);
+    state.workspace.train_monitor.in_flight.reset();
+    // learn
+    Data this_training_data = [&]() {
+        NN_PROFILE_SCOPE(ProfilePhase::Shuffle, 0);
+        return hy.training_data->get_shuffled(state.rng);
+    }();
+    // go over mini batches
+    for(size_t offset = 0; offset < n; offset += mini_batch_size) {
+        // make last batch smaller if necessary
+        size_t                     length = offset + mini_batch_size >= n ? n - offset : mini_batch_size;
+        const arma::subview<float> x      = this_training_data.get_mini_x(offset, length);
+        const arma::subview<float> y      = this_training_data.get_mini_y(offset, length);
+        update_mini_batch(net, x, y, state.workspace, hy, scheduled_eta(hy, state.eta, epoch + static_cast<float>(offset) / n), n * world_size(hy));
+        ++state.batches;
+        if(hy.divergence_check_interval && state.batches % hy.divergence_check_interval == 0) {
+            // costs differ between shards <- all ranks stop together
+            bool this_diverged = diverged(net, hy, state);
+            if(hy.communicator ? hy.communicator->any(this_diverged) : this_diverged)
+                return true;
+        }
+    }
+    return false;
+}
+
+size_t monitored_epochs(const HyperParameter& hy) {
+    return std::max({hy.test_costs.size(),
+                     hy.test_accuracies.size(),
+                     hy.eval_costs.size(),
+                     hy.eval_accuracies.size(),
+                     hy.train_costs.size(),
+                     hy.train_accuracies.size()});
+}
+
+void record_epoch(const Network&  net,
+                         HyperParameter& hy,
+                         size_t          epoch,
+                         long long       train_ns,
+                         long long       monitor_ns,
+                         size_t&         recorded_monitors) {
+    // all ranks together
+    size_t n             = hy.training_data->get_x().n_cols * world_size(hy);
+    float  train_seconds = train_ns / 1e9f;
+    hy.samples_per_second.push_back(train_ns ? n / train_seconds : 0.0f);
+    hy.epoch_times.push_back((train_ns + monitor_ns) / 1e9f);
+    hy.monitor_times.push_back(monitor_ns / 1e9f);
+    hy.gflops.push_back(train_ns ? static_cast<float>(backprop_flops(net) * n / train_ns) : 0.0f);
+    hy.rss_bytes.push_back(current_rss());
+    hy.peak_rss_bytes.push_back(peak_rss());
+    log_learn_extra("Epoch {} training complete: {:.0f} samples/s; {:.3f} s training; {:.3f} s monitoring; {:.2f} GFLOP/s; {} MiB",
+                    epoch,
+                    hy.samples_per_second.back(),
+                    train_seconds,
+                    hy.monitor_times.back(),
+                    hy.gflops.back(),
+                    hy.rss_bytes.back() >> 20);
+
+    // one file for all ranks <- rank 0 covers all of them
+    if(hy.metrics_path.empty() || (hy.communicator && hy.communicator->get_rank()))
+        return;
+    json line = {{"epoch", epoch},
+                 {"samples_per_second", hy.samples_per_second.back()},
+                 {"epoch_time_s", hy.epoch_times.back()},
+                 {"monitor_time_s", hy.monitor_times.back()},
+                 {"gflops", hy.gflops.back()},
+                 {"rss_bytes", hy.rss_bytes.back()},
+                 {"peak_rss_bytes", hy.peak_rss_bytes.back()}};
+    // monitors with their own epoch <- asynchronous monitoring is one epoch behind
+    std::vector<json> monitor_lines;
+    for(size_t n_monitored = monitored_epochs(hy); recorded_monitors < n_monitored; ++recorded_monitors) {
+        json& monitor_line = recorded_monitors == epoch ? line : monitor_lines.emplace_back(json {{"epoch", recorded_monitors}});
+        for(const auto& [name, results]: {std::make_pair("test_cost", &hy.test_costs),
+                                          std::make_pair("test_accuracy", &hy.test_accuracies),
+                                          std::make_pair("eval_cost", &hy.eval_costs),
+                                          std::make_pair("eval_accuracy", &hy.eval_accuracies),
+                                          std::make_pair("train_cost", &hy.train_costs),
+                                          std::make_pair("train_accuracy", &hy.train_accuracies)})
+            if(recorded_monitors < results->size())
+                monitor_line[name] = (*results)[recorded_monitors];
+    }
+    // metrics aren't worth aborting learning
+    // fresh start -> no lines of earlier runs; resumed -> keep lines before the checkpoint
+    std::ofstream file(hy.metrics_path, epoch ? std::ios::app : std::ios::trunc);
+    if(!file) {
+        log_learn_warn("Can't open metrics file '{}'!", hy.metrics_path);
+        return;
+    }
+    for(const json& monitor_line: monitor_lines)
+        file << monitor_line.dump() << std::endl;
+    file << line.dump() << std::endl;
+}
+
+bool diverged(const Network& net, const HyperParameter& hy, TrainingState& state) {
+    if(!net.flat.is_finite() || !state.workspace.nabla.flat.is_finite()) {
+        log_learn_warn("Non-finite weights or gradients after {} mini batches; learning aborted", state.batches);
+        return true;
+    }
+    InFlightMetrics& check_cost = state.workspace.check_cost;
+    if(!hy.divergence_factor || !check_cost.n)
+        return false;
+    // mean over all data sets since last check <- cost of single mini batches is too noisy
+    // non-finite values of cross entropy get replaced by cost <- check weights first
+    float cost = check_cost.cost_sum / check_cost.n;
+    check_cost.reset();
+    if(!std::isfinite(cost)) {
+        log_learn_warn("Non-finite cost after {} mini batches; learning aborted", state.batches);
+        return true;
+    }
+    // first check
+    if(state.batches == hy.divergence_check_interval) {
+        state.initial_check_cost = cost;
+        return false;
+    }
+    if(cost > hy.divergence_factor * state.initial_check_cost) {
+        log_learn_warn("Cost exploded from {} to {} after {} mini batches; learning aborted", state.initial_check_cost, cost,
+                       state.batches);
+        return true;
+    }
+    return false;
+}
+
+// score of metric in last epoch; bigger is better
+static float last_score(const HyperParameter& hy) {
+    switch(hy.best_weights_metric) {
+    case StopMetric::TestAccuracy:
+        return hy.test_accuracies.back();
+    case StopMetric::EvalAccuracy:
+        return hy.eval_accuracies.back();
+    case StopMetric::TrainAccuracy:
+        return hy.train_accuracies.back();
+    case StopMetric::TestCost:
+        return -hy.test_costs.back();
+    case StopMetric::EvalCost:
+        return -hy.eval_costs.back();
+    case StopMetric::TrainCost:
+        return -hy.train_costs.back();
+    case StopMetric::None:
+        break;
+    }
+    return 0.0f;
+}
+
+bool track_best(const Network& net, HyperParameter& hy, TrainingState& state) {
+    if(hy.best_weights_metric == StopMetric::None)
+        return false;
+    float score = last_score(hy);
+    if(state.best_flat.n_elem == 0 || score > state.best_score) {
+        state.best_flat         = net.flat;
+        state.best_score        = score;
+        state.best_epoch        = state.epoch;
+        state.epochs_since_best = 0;
+        return false;
+    }
+    ++state.epochs_since_best;
+    if(hy.patience && state.epochs_since_best >= hy.patience) {
+        log_learn_general("No improvement since epoch {} in {} epochs; learning terminated", state.best_epoch + 1,
+                          state.epochs_since_best);
+        return true;
+    }
+    return false;
+}
+
+void sgd(Network& net, HyperParameter& hy, TrainingState& state) {
     // info block
     log_learn_general("Using stochastic gradient descent:\n{}", hy.to_str());
+    if(state.epoch)
+        log_learn_general("Continuing after {} epochs", state.epoch);
 
-    auto begin = std::chrono::high_resolution_clock::now();
+    // time of earlier calls counts <- time_to_target and learn_time cover all of learning, also after resuming
+    std::chrono::high_resolution_clock::time_point begin =
+        std::chrono::high_resolution_clock::now() - std::chrono::high_resolution_clock::duration(state.learn_time);
     hy.is_valid();
-    // current eta may get changed over time
-    float eta = hy.init_eta;
-    // don't divide by 0
-    float  stop_eta = hy.stop_eta_fraction ? hy.init_eta / hy.stop_eta_fraction : 0;
-    size_t n        = hy.training_data->get_x().n_cols;
-
-    // used for momentum-based gradient descent
-    std::vector<arma::fmat> vel_biases(net.biases.size());
-    std::vector<arma::fmat> vel_weights(net.weights.size());
-    // set to all 0
-    for(size_t i = 0; i < vel_biases.size(); ++i) {
-        vel_biases[i]  = arma::fvec(net.biases[i].n_rows, arma::fill::zeros);
-        vel_weights[i] = arma::fmat(net.weights[i].n_rows, net.weights[i].n_cols, arma::fill::zeros);
+    if(hy.communicator) {
+        check_distributed(hy);
+        // all ranks start with the weights of rank 0
+        hy.communicator->broadcast(net.flat.memptr(), net.flat.n_elem);
+        log_learn_general("Data parallel training as rank {} of {}", hy.communicator->get_rank(), world_size(hy));
     }
+    // don't divide by 0
+    float stop_eta = hy.stop_eta_fraction ? hy.init_eta / hy.stop_eta_fraction : 0;
+    hy.learn_status = LearnStatus::Finished;
+    if(hy.profile)
+        Profiler::enable(hy.profile_trace && !(hy.communicator && hy.communicator->get_rank()));
 
-    size_t epoch = 0;
-    // gets reset after reducing eta
-    size_t epochs_since_last_reduction = 0;
     // go over epochs
     bool quit = false;
-    while(!quit) {
-        // learn
-        Data this_training_data = hy.training_data->get_shuffled();
-        // go over mini batches
-        for(size_t offset = 0; offset < n; offset += hy.mini_batch_size) {
-            // make last batch smaller if necessary
-            size_t length = offset + hy.mini_batch_size >= n ? n - offset : hy.mini_batch_size;
-            update_mini_batch(net,
-                              this_training_data.get_mini_x(offset, length),
-                              this_training_data.get_mini_y(offset, length),
-                              vel_biases,
-                              vel_weights,
-                              eta,
-                              hy.mu,
-                              hy.lambda_l1,
-                              hy.lambda_l2,
-                              n);
-        }
-        log_learn_extra("Epoch {} training complete", epoch);
-        update_learn_status(net, hy);
-
-        // learning rate schedule
-        // when there aren't enough epochs yet, don't do anything
-        if(hy.learning_schedule_type != LearningScheduleType::None &&
-           epochs_since_last_reduction >= hy.no_improvement_in) {
-            float sum_delta;
-            switch(hy.learning_schedule_type) {
-            case LearningScheduleType::TestAccuracy:
-                sum_delta = get_sum_delta(hy.test_accuracies.end() - hy.no_improvement_in, hy.test_accuracies.end());
+    // results in hy before this call have been written already
+    size_t recorded_monitors = monitored_epochs(hy);
+    if(!hy.async_monitoring) {
+        std::unique_ptr<CheckpointWriter> checkpoints;
+        if(!hy.checkpoint_path.empty())
+            checkpoints = std::make_unique<CheckpointWriter>(hy.checkpoint_path);
+        while(!quit) {
+            auto epoch_begin = std::chrono::high_resolution_clock::now();
+            if(train_epoch(net, hy, state, state.epoch)) {
+                hy.learn_status = LearnStatus::Diverged;
                 break;
-            case LearningScheduleType::EvalAccuracy:
-                sum_delta = get_sum_delta(hy.eval_accuracies.end() - hy.no_improvement_in, hy.eval_accuracies.end());
-                break;
-            case LearningScheduleType::None:
-                raise_critical("learning rate schedule broken");
+            }
+            auto train_end = std::chrono::high_resolution_clock::now();
+            update_learn_status(net, hy, state.workspace.train_monitor);
+            record_epoch(net,
+                         hy,
+                         state.epoch,
+                         (train_end - epoch_begin).count(),
+                         (std::chrono::high_resolution_clock::now() - train_end).count(),
+                         recorded_monitors);
+            if(hy.profile)
+                hy.epoch_profiles.push_back(Profiler::collect_epoch());
+            bool patience_over = track_best(net, hy, state);
+            quit               = end_epoch(hy, state.eta, stop_eta, state.epoch, state.epochs_since_last_reduction, begin) || patience_over;
+            if(checkpoints && !quit && checkpoints->due(hy, state.epoch)) {
+                state.learn_time = (std::chrono::high_resolution_clock::now() - begin).count();
+                checkpoints->write(net, hy, state);
+            }
+        }
+    } else {
+        // evaluation of last epoch runs while this epoch trains
+        // state.epoch only counts evaluated epochs
+        AsyncMonitor monitor(net);
+        while(!quit) {
+            auto   epoch_begin = std::chrono::high_resolution_clock::now();
+            size_t epoch       = state.epoch + monitor.busy();
+            if(train_epoch(net, hy, state, epoch)) {
+                hy.learn_status = LearnStatus::Diverged;
+                // keep results of last finished epoch
+                monitor.collect(hy);
                 break;
             }
-            // no improvement?
-            if(sum_delta <= 0.0f) {
-                eta /= 2;
-                // reset
-                epochs_since_last_reduction = 0;
-
-                log_learn_general("No improvement ({}) in last {} epochs; reducing learning rate to: {}", sum_delta,
-                                  hy.no_improvement_in, eta);
-
-                if(hy.stop_eta_fraction != -1.0f && eta < stop_eta) {
-                    log_learn_general("Learning rate dropped below 1/{}; learning terminated.", hy.stop_eta_fraction);
-                    quit = true;
-                }
+            auto train_end = std::chrono::high_resolution_clock::now();
+            monitor.snapshot(net);
+            if(monitor.busy()) {
+                // schedule lags one epoch behind
+                monitor.collect(hy);
+                bool patience_over = track_best(monitor.evaluated(), hy, state);
+                quit               = end_epoch(hy, state.eta, stop_eta, state.epoch, state.epochs_since_last_reduction, begin) || patience_over;
             }
-            // else
-            //      log_learn_extra("accuracy improvement in last {} epochs: {}", hy.no_improvement_in, sum_delta);
+            if(quit) {
+                // this epoch has been trained already
+                update_learn_status(net, hy, state.workspace.train_monitor);
+                track_best(net, hy, state);
+                ++state.epoch;
+                ++state.epochs_since_last_reduction;
+            } else if(epoch >= hy.max_epochs) {
+                // nothing left to overlap with
+                update_learn_status(net, hy, state.workspace.train_monitor);
+                track_best(net, hy, state);
+                quit = end_epoch(hy, state.eta, stop_eta, state.epoch, state.epochs_since_last_reduction, begin);
+            } else
+                monitor.start(hy, state.workspace.train_monitor);
+            // time waiting for monitors
+            record_epoch(net,
+                         hy,
+                         epoch,
+                         (train_end - epoch_begin).count(),
+                         (std::chrono::high_resolution_clock::now() - train_end).count(),
+                         recorded_monitors);
+            // monitoring of an epoch counts towards the epoch it overlaps with
+            if(hy.profile)
+                hy.epoch_profiles.push_back(Profiler::collect_epoch());
         }
-        if(epoch >= hy.max_epochs) {
-            log_learn_general("Maximum epochs exceeded; learning terminated");
-            quit = true;
+    }
+
+    restore_best(net, hy, state);
+    if(hy.profile)
+        Profiler::disable();
+    report_learn_time(hy, begin);
+    state.learn_time = hy.learn_time;
+}
+
+void restore_best(Network& net, HyperParameter& hy, const TrainingState& state) {
+    if(!state.best_flat.n_elem)
+        return;
+    // same size <- views stay valid
+    std::copy(state.best_flat.begin(), state.best_flat.end(), net.flat.begin());
+    hy.best_epoch = state.best_epoch + 1;
+    log_learn_general("Restored weights of epoch {} with best score {}", hy.best_epoch, std::abs(state.best_score));
+}
+
+bool end_epoch(HyperParameter&                                hy,
+               float&                                         eta,
+               float                                          stop_eta,
+               size_t&                                        epoch,
+               size_t&                                        epochs_since_last_reduction,
+               std::chrono::high_resolution_clock::time_point begin) {
+    bool quit = false;
+    // target accuracy
+    if(hy.target_accuracy && !hy.epochs_to_target) {
+        float accuracy = hy.monitor_eval_accuracy ? hy.eval_accuracies.back() / hy.eval_data->get_x().n_cols
+                                                  : hy.test_accuracies.back() / hy.test_data->get_x().n_cols;
+        if(accuracy >= hy.target_accuracy) {
+            hy.epochs_to_target = epoch + 1;
+            hy.time_to_target   = (std::chrono::high_resolution_clock::now() - begin).count();
+            log_learn_general("Target accuracy {} reached after {} epochs and {} seconds", hy.target_accuracy,
+                              hy.epochs_to_target, hy.time_to_target / 1e9f);
+            if(hy.stop_at_target) {
+                log_learn_general("Target accuracy reached; learning terminated");
+                quit = true;
+            }
+        }
+    }
+    // learning rate schedule
+    // when there aren't enough epochs yet, don't do anything
+    if(hy.accuracy_schedule() && epochs_since_last_reduction >= hy.no_improvement_in) {
+        float sum_delta;
+        switch(hy.learning_schedule_type) {
+        case LearningScheduleType::TestAccuracy:
+            sum_delta = get_sum_delta(hy.test_accuracies.end() - hy.no_improvement_in, hy.test_accuracies.end());
+            break;
+        case LearningScheduleType::EvalAccuracy:
+            sum_delta = get_sum_delta(hy.eval_accuracies.end() - hy.no_improvement_in, hy.eval_accuracies.end());
+            break;
+        default:
+            raise_critical("learning rate schedule broken");
+            break;
+        }
+        // no improvement?
+        if(sum_delta <= 0.0f) {
+            eta /= 2;
+            // reset
+            epochs_since_last_reduction = 0;
+
+            log_learn_general("No improvement ({}) in last {} epochs; reducing learning rate to: {}", sum_delta,
+                              hy.no_improvement_in, eta);
+
+            if(hy.stop_eta_fraction != -1.0f && eta < stop_eta) {
+                log_learn_general("Learning rate dropped below 1/{}; learning terminated.", hy.stop_eta_fraction);
+                quit = true;
+            }
+        }
+        // else
+        //      log_learn_extra("accuracy improvement in last {} epochs: {}", hy.no_improvement_in, sum_delta);
+    }
+    if(epoch >= hy.max_epochs) {
+        log_learn_general("Maximum epochs exceeded; learning terminated");
+        quit = true;
+    }
+    ++epoch;
+    ++epochs_since_last_reduction;
+    return quit;
+}
+
+float scheduled_eta(const HyperParameter& hy, float eta, float progress) {
+    const float pi = 3.14159265358979f;
+    switch(hy.learning_schedule_type) {
+    case LearningScheduleType::StepDecay:
+        eta = hy.init_eta * std::pow(hy.decay_rate, std::floor(progress / hy.decay_epochs));
+        break;
+    case LearningScheduleType::Exponential:
+        eta = hy.init_eta * std::pow(hy.decay_rate, progress);
+        break;
+    case LearningScheduleType::CosineAnnealing: {
+        // find current cycle
+        float cycle_begin  = 0.0f;
+        float cycle_length = hy.restart_epochs;
+        while(progress >= cycle_begin + cycle_length) {
+            cycle_begin += cycle_length;
+            cycle_length *= hy.restart_mult;
         }
-        ++epoch;
-        ++epochs_since_last_reduction;
+        float cycle_progress = (progress - cycle_begin) / cycle_length;
+        eta                  = hy.min_eta + 0.5f * (hy.init_eta - hy.min_eta) * (1.0f + std::cos(pi * cycle_progress));
+        break;
     }
-    // report
+    case LearningScheduleType::OneCycle: {
+        // sgd runs max_epochs + 1 epochs
+        float total = hy.max_epochs + 1.0f;
+        float peak  = hy.one_cycle_peak * total;
+        if(progress < peak) {
+            float start_eta = hy.init_eta / hy.one_cycle_div;
+            eta             = start_eta + (hy.init_eta - start_eta) * progress / peak;
+        } else {
+            float anneal_progress = std::min((progress - peak) / (total - peak), 1.0f);
+            eta = hy.min_eta + 0.5f * (hy.init_eta - hy.min_eta) * (1.0f + std::cos(pi * anneal_progress));
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    // linear warmup <- current mini batch counts as done, never use exactly 0
+    if(progress < hy.warmup_epochs)
+        eta *= std::min((progress + static_cast<float>(hy.mini_batch_size) / (hy.training_data->get_x().n_cols * world_size(hy))) /
+                            hy.warmup_epochs,
+                        1.0f);
+    return eta;
+}
+
+double backprop_flops(const Network& net) {
+    double flops = 0.0;
+    for(size_t left_layer_idx = 0; left_layer_idx < net.num_layers - 1; ++left_layer_idx) {
+        double multiply_adds = static_cast<double>(net.sizes[left_layer_idx]) * net.sizes[left_layer_idx + 1];
+        // feedforward and BP4; BP2 isn't needed for the first layer
+        flops += (left_layer_idx ? 3.0 : 2.0) * 2.0 * multiply_adds;
+    }
+    return flops;
+}
+
+void report_learn_time(HyperParameter& hy, std::chrono::high_resolution_clock::time_point begin) {
     auto      end        = std::chrono::high_resolution_clock::now();
     long long delta_time = (end - begin).count();
     hy.learn_time        = delta_time;
@@ -108,71 +441,59 @@ void sgd(Network& net, HyperParameter& hy) {
 void update_mini_batch(Network&                   net,
                        const arma::subview<float> x,
                        const arma::subview<float> y,
-                       std::vector<arma::fmat>&   vel_biases,
-                       std::vector<arma::fmat>&   vel_weights,
+                       TrainingWorkspace&         workspace,
+                       const HyperParameter&      hy,
                        float                      eta,
-                       float                      mu,
-                       float                      lambda_l1,
-                       float                      lambda_l2,
                        size_t                     n) {
     // sums of gradients <- how do certain weights and biases change the cost
     // layer-wise
-    std::vector<arma::fvec> nabla_b(net.biases.size());
-    std::vector<arma::fmat> nabla_w(net.weights.size());
-    // set to size of weights and biases
     // start at all 0
-    for(size_t i = 0; i < nabla_b.size(); ++i) {
-        nabla_b[i] = arma::fvec(net.biases[i].n_rows, arma::fill::zeros);
-        nabla_w[i] = arma::fmat(net.weights[i].n_rows, net.weights[i].n_cols, arma::fill::zeros);
-    }
+    workspace.nabla.flat.zeros();
 
     // use backprop to calculate gradient -> de-/increase delta
     // use matrix or multiple vectors
 #if 1
-    backprop(net, x, y, nabla_b, nabla_w);
+    InFlightMetrics& in_flight  = workspace.train_monitor.in_flight;
+    InFlightMetrics& check_cost = workspace.check_cost;
+    backprop(net, x, y, workspace.nabla.biases, workspace.nabla.weights, in_flight.cost || in_flight.accuracy ? &in_flight : nullptr,
+             check_cost.cost ? &check_cost : nullptr);
 #else
     for(size_t idx = 0; idx < x.n_cols; ++idx) {
-        backprop(x.col(idx), y.col(idx), nabla_b, nabla_w);
+        backprop(x.col(idx), y.col(idx), workspace.nabla.biases, workspace.nabla.weights);
     }
 #endif
 
+    // sum gradients of global mini batch
+    if(hy.communicator) {
+        NN_PROFILE_SCOPE(ProfilePhase::AllReduce, 0);
+        hy.communicator->all_reduce(workspace.nabla.flat.memptr(), workspace.nabla.flat.n_elem, hy.fp16_gradients);
+    }
+
     // optimization
-    float eta_over_length  = eta / x.n_cols;
-    float lambda_l1_over_n = lambda_l1 / n;
-    float lambda_l2_over_n = lambda_l2 / n;
     // update weights and biases
     // ignore post process layer
     // move in opposite direction -> reduce cost
-    for(size_t i = 0; i < net.weights.size() - net.post_process; ++i) {
-        // include weight decay
-        // L1 regularization
-        vel_weights[i] -= eta * lambda_l1_over_n * arma::sign(net.weights[i]);
-        // L2 regularization
-        vel_weights[i] *= 1.0f - eta * lambda_l2_over_n;
-
-        // update velocity
-        // apply momentum co-efficient
-        vel_weights[i] *= mu;
-        vel_biases[i] *= mu;
-        // approx gradient with mini batch
-        vel_weights[i] -= eta_over_length * nabla_w[i];
-        vel_biases[i] -= eta_over_length * nabla_b[i];
-
-        // apply velocity
-        net.weights[i] += vel_weights[i];
-        net.biases[i] += vel_biases[i];
-    }
+    NN_PROFILE_SCOPE(ProfilePhase::Optimizer, 0);
+    workspace.optimizer->step(net, workspace, hy, eta, x.n_cols * world_size(hy), n);
+    // pruned weights stay 0
+    apply_weight_mask(net);
 }
 
 void backprop(const Network&             net,
               const arma::subview<float> x,
               const arma::subview<float> y,
               std::vector<arma::fvec>&   nabla_b,
-              std::vector<arma::fmat>&   nabla_w) {
+              std::vector<arma::fmat>&   nabla_w,
+              InFlightMetrics*           in_flight,
+              InFlightMetrics*           check_cost) {
     // activations layer by layer <- needed by backprop algorithm
     // one per layer
-    std::vector<arma::fmat> activations {x};
+    std::vector<arma::fmat> activations;
     activations.reserve(net.num_layers);
+    {
+        NN_PROFILE_SCOPE(ProfilePhase::Gather, 0);
+        activations.emplace_back(x);
+    }
     // list of inputs for sigmoid function
     // one for each layer, except input
     std::vector<arma::fmat> zs;
@@ -180,29 +501,43 @@ void backprop(const Network&             net,
 
     // feedforward
     for(size_t left_layer_idx = 0; left_layer_idx < net.num_layers - 1; ++left_layer_idx) {
+        NN_PROFILE_SCOPE(ProfilePhase::Forward, left_layer_idx);
         // extend biases with as many copied columns as there are data sets in the batch
         //                               <- actually right layer
         arma::fmat biases_mat = net.biases[left_layer_idx] * arma::fmat(1, x.n_cols, arma::fill::ones);
         // weighted input
         zs.emplace_back(net.weights[left_layer_idx] * activations[activations.size() - 1] + biases_mat);
-        activations.emplace_back(sigmoid(zs[zs.size() - 1]));
+        activations.emplace_back(net.activate(left_layer_idx + 1, zs[zs.size() - 1]));
     }
+    if(in_flight)
+        in_flight->add(net, activations[activations.size() - 1], y);
+    if(check_cost)
+        check_cost->add(net, activations[activations.size() - 1], y);
 
     // calculate error for last layer (BP1)
-    arma::fmat error = net.cost->error(zs[zs.size() - 1], activations[activations.size() - 1], y);
-    // get gradient with respect to biases (BP3)
-    // sum errors from each data set together -> sum into single column
-    nabla_b[nabla_b.size() - 1] += arma::sum(error, 1);
-    // get gradient with respect to weights (BP4)
-    nabla_w[nabla_w.size() - 1] += error * activations[activations.size() - 2].t();
+    arma::fmat error;
+    {
+        NN_PROFILE_SCOPE(ProfilePhase::CostError, 0);
+        error = net.cost->error(zs[zs.size() - 1], activations[activations.size() - 1], y);
+    }
+    {
+        NN_PROFILE_SCOPE(ProfilePhase::Backward, net.num_layers - 2);
+        // get gradient with respect to biases (BP3)
+        // sum errors from each data set together -> sum into single column
+        nabla_b[nabla_b.size() - 1] += arma::sum(error, 1);
+        // get gradient with respect to weights (BP4)
+        nabla_w[nabla_w.size() - 1] += error * activations[activations.size() - 2].t();
+    }
 
     // for all other layers
     // start at penultimate element of zs and go back to first
     for(int64_t layer_idx = net.num_layers - 3; layer_idx >= 0; --layer_idx) {
-        // get input for sigmoid function of current layer
-        arma::fmat sp = sigmoid_prime(zs[layer_idx]);
+        NN_PROFILE_SCOPE(ProfilePhase::Backward, layer_idx);
         // calculate error for current layer with error from layer to the right (BP2)
-        error = (net.weights[layer_idx + 1].t() * error) % sp;
+        error = net.weights[layer_idx + 1].t() * error;
+        // derivative of linear layers is 1
+        if(!net.is_linear(layer_idx + 1))
+            error %= sigmoid_prime(zs[layer_idx]);
 
         // update gradient like with last layer
         nabla_b[layer_idx] += arma::sum(error, 1);
@@ -1,31 +1,88 @@
 #pragma once
 #include "hyper/data.h"
+#include "learn/workspace.h"
 #include "net/net.h"
 
+#include <chrono>
+
 namespace NeuralNet {
 // stochastic gradient descent
 void sgd(Network& net, HyperParameter& hy);
 
-// update weights and biases
+// continue stochastic gradient descent from state; state gets updated
+// max_epochs counts all epochs including the ones already in state
+// learn_time and time_to_target include the time of earlier calls with state
+// optimizer_type must be the one state was created with
+void sgd(Network& net, HyperParameter& hy, TrainingState& state);
+
+// snapshot net when it scored best so far in epoch state.epoch, see HyperParameter::best_weights_metric
+// call after the monitors of the epoch and before end_epoch
+// return true when patience has run out
+bool track_best(const Network& net, HyperParameter& hy, TrainingState& state);
+
+// copy weights of best epoch in state back into net, if there are any
+void restore_best(Network& net, HyperParameter& hy, const TrainingState& state);
+
+// apply learning rate schedule and max epochs after epoch has been evaluated
+// increments epoch and epochs_since_last_reduction
+// return true when learning should be terminated
+// record reaching target accuracy
+bool end_epoch(HyperParameter&                                hy,
+               float&                                         eta,
+               float                                          stop_eta,
+               size_t&                                        epoch,
+               size_t&                                        epochs_since_last_reduction,
+               std::chrono::high_resolution_clock::time_point begin);
+
+// learning rate for mini batch at progress epochs since start, fractions for mini batches
+// eta = current learning rate of accuracy based schedules, returned unchanged for those
+// includes warmup
+float scheduled_eta(const HyperParameter& hy, float eta, float progress);
+
+// check for divergence after a mini batch
+// non-finite weights or gradients, or exploding cost, see HyperParameter::divergence_factor
+// cost is the mean of workspace.check_cost, which gets reset
+// return true on divergence
+bool diverged(const Network& net, const HyperParameter& hy, TrainingState& state);
+
+// floating point operations of the matrix products in backprop for one data set
+// feedforward and BP4 for all layers, BP2 for all but the first
+double backprop_flops(const Network& net);
+
+// amount of epochs with results of monitors
+size_t monitored_epochs(const HyperParameter& hy);
+
+// append throughput and resources of epoch to results, log them and write them to metrics file
+// monitors of epochs from recorded_monitors on get written too, recorded_monitors gets updated
+void record_epoch(const Network&  net,
+                  HyperParameter& hy,
+                  size_t          epoch,
+                  long long       train_ns,
+                  long long       monitor_ns,
+                  size_t&         recorded_monitors);
+
+// store and log time since begin
+void report_learn_time(HyperParameter& hy, std::chrono::high_resolution_clock::time_point begin);
+
+// update weights and biases with optimizer of workspace
 // eta = learning rate
-// mu = momentum co-efficient
-// lambda = regularization parameter
+// n = amount of data sets in training data of all ranks
 void update_mini_batch(Network&                   net,
                        const arma::subview<float> x,
                        const arma::subview<float> y,
-                       std::vector<arma::fmat>&   vel_biases,
-                       std::vector<arma::fmat>&   vel_weights,
+                       TrainingWorkspace&         workspace,
+                       const HyperParameter&      hy,
                        float                      eta,
-                       float                      mu,
-                       float                      lambda_l1,
-                       float                      lambda_l2,
                        size_t                     n);
 
 // set nabla_b and nabla_w to sum of delta_nabla_b and delta_nabla_w representing gradient of cost function for all data sets in batch
 // layer-by-layer, congruent to net->biases and net->weights
+// in_flight or check_cost given -> add output activations of feedforward
 void backprop(const Network&             net,
               const arma::subview<float> x,
               const arma::subview<float> y,
               std::vector<arma::fvec>&   nabla_b,
-              std::vector<arma::fmat>&   nabla_w);
+              std::vector<arma::fmat>&   nabla_w,
+              InFlightMetrics*           in_flight  = nullptr,
+              InFlightMetrics*           check_cost = nullptr);
 } // namespace NeuralNet
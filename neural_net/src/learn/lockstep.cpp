@@ -0,0 +1,187 @@
+#include "lockstep.h"
+
+#include "learn/eval.h"
+#include "learn/learn.h"
+#include "net/pruning.h"
+#include "pch.h"
+
+namespace NeuralNet {
+// as if the network had been learning alone for state.learn_time
+static std::chrono::high_resolution_clock::time_point own_begin(const TrainingState& state) {
+    return std::chrono::high_resolution_clock::now() - std::chrono::high_resolution_clock::duration(state.learn_time);
+}
+
+void lockstep_sgd(std::vector<Network>& nets, std::vector<HyperParameter>& hys, unsigned seed) {
+    if(nets.empty() || nets.size() != hys.size())
+        raise_critical("Lockstep learning requires one hyper parameter per network.");
+    for(size_t model_idx = 0; model_idx < nets.size(); ++model_idx) {
+        hys[model_idx].is_valid();
+        if(!hys[model_idx].checkpoint_path.empty())
+            raise_critical("Lockstep learning doesn't support checkpoints.");
+        // would train on the shard of this rank only
+        if(hys[model_idx].communicator)
+            raise_critical("Lockstep learning doesn't support data parallel training.");
+        // profiles of the shared mini batches can't be told apart per network
+        if(hys[model_idx].async_monitoring || hys[model_idx].profile)
+            raise_critical("Lockstep learning doesn't support asynchronous monitoring or profiling.");
+        for(size_t other_idx = 0; other_idx < model_idx; ++other_idx)
+            if(!hys[model_idx].metrics_path.empty() && hys[model_idx].metrics_path == hys[other_idx].metrics_path)
+                raise_critical("Lockstep learning requires a separate metrics file per network.");
+        if(nets[model_idx].sizes != nets[0].sizes)
+            raise_critical("Lockstep learning requires networks of the same sizes.");
+        if(hys[model_idx].training_data != hys[0].training_data || hys[model_idx].mini_batch_size != hys[0].mini_batch_size)
+            raise_critical("Lockstep learning requires the same training data and mini batch size.");
+    }
+    // info block
+    log_learn_general("Using stochastic gradient descent on {} networks in lockstep:\n{}", nets.size(), hys[0].to_str());
+
+    size_t      n_models        = nets.size();
+    const Data* training_data   = hys[0].training_data;
+    size_t      mini_batch_size = hys[0].mini_batch_size;
+    size_t      n               = training_data->get_x().n_cols;
+
+    std::vector<TrainingState> states;
+    std::vector<float>         stop_etas;
+    std::vector<size_t>        recorded_monitors;
+    states.reserve(n_models);
+    for(size_t model_idx = 0; model_idx < n_models; ++model_idx) {
+        HyperParameter& hy = hys[model_idx];
+        hy.learn_status    = LearnStatus::Finished;
+        states.emplace_back(nets[model_idx], hy);
+        // don't divide by 0
+        stop_etas.push_back(hy.stop_eta_fraction ? hy.init_eta / hy.stop_eta_fraction : 0);
+        recorded_monitors.push_back(monitored_epochs(hy));
+    }
+    arma::fmat stacked_weights(nets[0].sizes[1] * n_models, nets[0].sizes[0]);
+
+    std::vector<bool> active(n_models, true);
+    size_t            n_active = n_models;
+    // one order for all networks <- they share the mini batches
+    std::mt19937 rng(seed);
+    while(n_active) {
+        auto   epoch_begin = std::chrono::high_resolution_clock::now();
+        size_t n_trained   = n_active;
+        // learn
+        Data this_training_data = training_data->get_shuffled(rng);
+        for(TrainingState& state: states)
+            state.workspace.train_monitor.in_flight.reset();
+        // go over mini batches
+        for(size_t offset = 0; offset < n; offset += mini_batch_size) {
+            // make last batch smaller if necessary
+            size_t                     length = offset + mini_batch_size >= n ? n - offset : mini_batch_size;
+            const arma::subview<float> x      = this_training_data.get_mini_x(offset, length);
+            const arma::subview<float> y      = this_training_data.get_mini_y(offset, length);
+            for(size_t model_idx = 0; model_idx < n_models; ++model_idx)
+                if(active[model_idx])
+                    states[model_idx].workspace.nabla.flat.zeros();
+            lockstep_backprop(nets, active, x, y, states, stacked_weights);
+            for(size_t model_idx = 0; model_idx < n_models; ++model_idx) {
+                if(!active[model_idx])
+                    continue;
+                TrainingState&  state = states[model_idx];
+                HyperParameter& hy    = hys[model_idx];
+                float           eta   = scheduled_eta(hy, state.eta, state.epoch + static_cast<float>(offset) / n);
+                state.workspace.optimizer->step(nets[model_idx], state.workspace, hy, eta, length, n);
+                apply_weight_mask(nets[model_idx]);
+                ++state.batches;
+                if(hy.divergence_check_interval && state.batches % hy.divergence_check_interval == 0 &&
+                   diverged(nets[model_idx], hy, state)) {
+                    hy.learn_status   = LearnStatus::Diverged;
+                    active[model_idx] = false;
+                    --n_active;
+                    state.learn_time += (std::chrono::high_resolution_clock::now() - epoch_begin).count() / n_trained;
+                    restore_best(nets[model_idx], hy, state);
+                    report_learn_time(hy, own_begin(state));
+                }
+            }
+        }
+        // each network gets its share of the shared training time
+        long long train_ns = (std::chrono::high_resolution_clock::now() - epoch_begin).count() / n_trained;
+        for(size_t model_idx = 0; model_idx < n_models; ++model_idx) {
+            if(!active[model_idx])
+                continue;
+            TrainingState&  state         = states[model_idx];
+            HyperParameter& hy            = hys[model_idx];
+            auto            monitor_begin = std::chrono::high_resolution_clock::now();
+            update_learn_status(nets[model_idx], hy, state.workspace.train_monitor);
+            long long monitor_ns = (std::chrono::high_resolution_clock::now() - monitor_begin).count();
+            record_epoch(nets[model_idx], hy, state.epoch, train_ns, monitor_ns, recorded_monitors[model_idx]);
+            state.learn_time += train_ns + monitor_ns;
+            bool patience_over = track_best(nets[model_idx], hy, state);
+            if(end_epoch(hy, state.eta, stop_etas[model_idx], state.epoch, state.epochs_since_last_reduction, own_begin(state)) ||
+               patience_over) {
+                active[model_idx] = false;
+                --n_active;
+                restore_best(nets[model_idx], hy, state);
+                report_learn_time(hy, own_begin(state));
+            }
+        }
+    }
+}
+
+void lockstep_backprop(const std::vector<Network>& nets,
+                       const std::vector<bool>&    active,
+                       const arma::subview<float>  x,
+                       const arma::subview<float>  y,
+                       std::vector<TrainingState>& states,
+                       arma::fmat&                 stacked_weights) {
+    size_t num_layers = nets[0].num_layers;
+    size_t first_size = nets[0].sizes[1];
+    for(size_t model_idx = 0; model_idx < nets.size(); ++model_idx)
+        stacked_weights.rows(model_idx * first_size, (model_idx + 1) * first_size - 1) = nets[model_idx].weights[0];
+    // weighted input of first layer of all networks in one gemm
+    arma::fmat stacked_zs = stacked_weights * x;
+    // errors of first layer of all networks; 0 for inactive ones
+    arma::fmat stacked_errors(stacked_zs.n_rows, x.n_cols, arma::fill::zeros);
+
+    for(size_t model_idx = 0; model_idx < nets.size(); ++model_idx) {
+        if(!active[model_idx])
+            continue;
+        const Network&           net     = nets[model_idx];
+        std::vector<arma::fvec>& nabla_b = states[model_idx].workspace.nabla.biases;
+        std::vector<arma::fmat>& nabla_w = states[model_idx].workspace.nabla.weights;
+        // same as in backprop but without input layer
+        std::vector<arma::fmat> activations;
+        std::vector<arma::fmat> zs;
+        activations.reserve(num_layers - 1);
+        zs.reserve(num_layers - 1);
+
+        // feedforward
+        arma::fmat biases_mat = net.biases[0] * arma::fmat(1, x.n_cols, arma::fill::ones);
+        zs.emplace_back(stacked_zs.rows(model_idx * first_size, (model_idx + 1) * first_size - 1) + biases_mat);
+        activations.emplace_back(net.activate(1, zs[0]));
+        for(size_t left_layer_idx = 1; left_layer_idx < num_layers - 1; ++left_layer_idx) {
+            biases_mat = net.biases[left_layer_idx] * arma::fmat(1, x.n_cols, arma::fill::ones);
+            zs.emplace_back(net.weights[left_layer_idx] * activations[activations.size() - 1] + biases_mat);
+            activations.emplace_back(net.activate(left_layer_idx + 1, zs[zs.size() - 1]));
+        }
+        InFlightMetrics& in_flight = states[model_idx].workspace.train_monitor.in_flight;
+        if(in_flight.cost || in_flight.accuracy)
+            in_flight.add(net, activations[activations.size() - 1], y);
+        InFlightMetrics& check_cost = states[model_idx].workspace.check_cost;
+        if(check_cost.cost)
+            check_cost.add(net, activations[activations.size() - 1], y);
+
+        // calculate error for last layer (BP1)
+        arma::fmat error = net.cost->error(zs[zs.size() - 1], activations[activations.size() - 1], y);
+        // go back to first layer; activations[i] belong to layer i + 1
+        for(size_t layer_idx = num_layers - 2; layer_idx > 0; --layer_idx) {
+            // BP3 and BP4
+            nabla_b[layer_idx] += arma::sum(error, 1);
+            nabla_w[layer_idx] += error * activations[layer_idx - 1].t();
+            // BP2
+            error = net.weights[layer_idx].t() * error;
+            if(!net.is_linear(layer_idx))
+                error %= sigmoid_prime(zs[layer_idx - 1]);
+        }
+        nabla_b[0] += arma::sum(error, 1);
+        stacked_errors.rows(model_idx * first_size, (model_idx + 1) * first_size - 1) = error;
+    }
+
+    // gradients of first layer weights of all networks in one gemm
+    arma::fmat stacked_nabla_w = stacked_errors * x.t();
+    for(size_t model_idx = 0; model_idx < nets.size(); ++model_idx)
+        if(active[model_idx])
+            states[model_idx].workspace.nabla.weights[0] += stacked_nabla_w.rows(model_idx * first_size, (model_idx + 1) * first_size - 1);
+}
+} // namespace NeuralNet
@@ -0,0 +1,29 @@
+#pragma once
+#include "learn/workspace.h"
+#include "net/net.h"
+
+#include <random>
+#include <vector>
+
+namespace NeuralNet {
+// stochastic gradient descent of multiple networks with the same sizes on the same mini batches at once
+// first layer weights of all networks are stacked -> one big gemm instead of many small ones
+// each network keeps its own gradients, optimizer state, learning rate schedule and results in hys
+// all hys need the same training data and mini batch size
+// a network stops getting updated when its own termination criteria are met, including patience
+// like sgd, each network ends with the weights of its best epoch when best_weights_metric is set
+// training time of an epoch is split evenly among the networks trained in it, monitoring time counts for its network only
+// learn_time, time_to_target, samples_per_second, epoch_times and gflops use these shares -> comparable to sgd
+// no asynchronous monitoring or profiling; each network needs its own metrics_path
+// seed: shuffling of the training data, same seed and weights -> same mini batches
+void lockstep_sgd(std::vector<Network>& nets, std::vector<HyperParameter>& hys, unsigned seed = std::random_device {}());
+
+// add gradients of all active networks for the same mini batch to their workspaces
+// stacked_weights: sizes[1] * nets.size() x sizes[0]; gets filled with first layer weights of all networks
+void lockstep_backprop(const std::vector<Network>& nets,
+                       const std::vector<bool>&    active,
+                       const arma::subview<float>  x,
+                       const arma::subview<float>  y,
+                       std::vector<TrainingState>& states,
+                       arma::fmat&                 stacked_weights);
+} // namespace NeuralNet
@@ -0,0 +1,203 @@
+#include "optimizer.h"
+
+#include "learn/workspace.h"
+#include "pch.h"
+
+namespace NeuralNet {
+// amount of elements processed by one thread at once
+static constexpr size_t s_block_size = 1 << 14;
+// don't start threads for small networks
+static constexpr size_t s_parallel_threshold = 1 << 16;
+
+// call kernel(segment, begin, size) for blocks of all segments
+template<typename Kernel>
+static void for_each_block(const ParameterSegment* segments, size_t n_segments, Kernel kernel) {
+    size_t n_blocks = 0;
+    size_t n_params = 0;
+    for(size_t i = 0; i < n_segments; ++i) {
+        n_blocks += (segments[i].size + s_block_size - 1) / s_block_size;
+        n_params += segments[i].size;
+    }
+
+    // signed for msvc
+#pragma omp parallel for schedule(static) if(n_params >= s_parallel_threshold)
+    for(int64_t block = 0; block < static_cast<int64_t>(n_blocks); ++block) {
+        // find segment of this block
+        size_t segment_idx  = 0;
+        size_t block_offset = block;
+        while(block_offset * s_block_size >= segments[segment_idx].size) {
+            block_offset -= (segments[segment_idx].size + s_block_size - 1) / s_block_size;
+            ++segment_idx;
+        }
+        const ParameterSegment& segment = segments[segment_idx];
+        size_t                  begin   = block_offset * s_block_size;
+        kernel(segment, begin, std::min(s_block_size, segment.size - begin));
+    }
+}
+
+// weights and biases of all layers except post process layer
+// all weights are in front of all biases
+static std::array<ParameterSegment, 2> trainable_segments(Network& net, TrainingWorkspace& workspace) {
+    size_t trainable_layers = net.weights.size() - net.post_process;
+    size_t n_weights        = net.n_weights();
+    float* second_moment    = workspace.second_moment.flat.n_elem ? workspace.second_moment.flat.memptr() : nullptr;
+    return {{{net.flat.memptr(),
+              workspace.velocity.flat.memptr(),
+              second_moment,
+              workspace.nabla.flat.memptr(),
+              net.weight_offset(trainable_layers),
+              true},
+             {net.flat.memptr() + n_weights,
+              workspace.velocity.flat.memptr() + n_weights,
+              second_moment ? second_moment + n_weights : nullptr,
+              workspace.nabla.flat.memptr() + n_weights,
+              net.bias_offset(trainable_layers) - n_weights,
+              false}}};
+}
+
+static inline float sign(float x) {
+    return static_cast<float>((x > 0.0f) - (x < 0.0f));
+}
+
+void fused_momentum_update(const ParameterSegment* segments,
+                           size_t                  n_segments,
+                           float                   eta_over_length,
+                           float                   mu,
+                           float                   l1_step,
+                           float                   l2_scale) {
+    for_each_block(segments, n_segments, [=](const ParameterSegment& segment, size_t begin, size_t size) {
+        float* __restrict       params    = segment.params + begin;
+        float* __restrict       velocity  = segment.velocity + begin;
+        const float* __restrict nabla     = segment.nabla + begin;
+        float                   seg_l1    = segment.regularize ? l1_step : 0.0f;
+        float                   seg_scale = segment.regularize ? l2_scale : 1.0f;
+#pragma omp simd
+        for(size_t i = 0; i < size; ++i) {
+            float w = params[i];
+            float v = velocity[i];
+            v -= seg_l1 * sign(w);
+            v *= seg_scale;
+            v *= mu;
+            v -= eta_over_length * nabla[i];
+            velocity[i] = v;
+            params[i]   = w + v;
+        }
+    });
+}
+
+std::shared_ptr<Optimizer> Optimizer::get(OptimizerType type) {
+    switch(type) {
+    case OptimizerType::Momentum:
+        return std::make_shared<MomentumOptimizer>();
+    case OptimizerType::Nesterov:
+        return std::make_shared<NesterovOptimizer>();
+    case OptimizerType::RMSProp:
+        return std::make_shared<RMSPropOptimizer>();
+    case OptimizerType::Adam:
+        return std::make_shared<AdamOptimizer>(false);
+    case OptimizerType::AdamW:
+        return std::make_shared<AdamOptimizer>(true);
+    }
+    raise_critical("Unable to find optimizer of type {}", static_cast<int>(type));
+}
+
+void MomentumOptimizer::step(Network& net, TrainingWorkspace& workspace, const HyperParameter& hy, float eta, size_t length, size_t n) {
+    std::array<ParameterSegment, 2> segments = trainable_segments(net, workspace);
+    // include weight decay
+    fused_momentum_update(segments.data(),
+                          segments.size(),
+                          eta / length,
+                          hy.mu,
+                          eta * (hy.lambda_l1 / n),
+                          1.0f - eta * (hy.lambda_l2 / n));
+    ++workspace.step;
+}
+
+void NesterovOptimizer::step(Network& net, TrainingWorkspace& workspace, const HyperParameter& hy, float eta, size_t length, size_t n) {
+    std::array<ParameterSegment, 2> segments = trainable_segments(net, workspace);
+
+    float mu               = hy.mu;
+    float one_over_length  = 1.0f / length;
+    float lambda_l1_over_n = hy.lambda_l1 / n;
+    float lambda_l2_over_n = hy.lambda_l2 / n;
+    for_each_block(segments.data(), segments.size(), [=](const ParameterSegment& segment, size_t begin, size_t size) {
+        float* __restrict       params   = segment.params + begin;
+        float* __restrict       velocity = segment.velocity + begin;
+        const float* __restrict nabla    = segment.nabla + begin;
+        float                   l1       = segment.regularize ? lambda_l1_over_n : 0.0f;
+        float                   l2       = segment.regularize ? lambda_l2_over_n : 0.0f;
+#pragma omp simd
+        for(size_t i = 0; i < size; ++i) {
+            float w = params[i];
+            float g = nabla[i] * one_over_length + l1 * sign(w) + l2 * w;
+            float v = mu * velocity[i] - eta * g;
+            velocity[i] = v;
+            // step along the updated velocity from the look ahead position
+            params[i] = w + mu * v - eta * g;
+        }
+    });
+    ++workspace.step;
+}
+
+void RMSPropOptimizer::step(Network& net, TrainingWorkspace& workspace, const HyperParameter& hy, float eta, size_t length, size_t n) {
+    std::array<ParameterSegment, 2> segments = trainable_segments(net, workspace);
+
+    float rho              = hy.beta2;
+    float epsilon          = hy.epsilon;
+    float one_over_length  = 1.0f / length;
+    float lambda_l1_over_n = hy.lambda_l1 / n;
+    float lambda_l2_over_n = hy.lambda_l2 / n;
+    for_each_block(segments.data(), segments.size(), [=](const ParameterSegment& segment, size_t begin, size_t size) {
+        float* __restrict       params        = segment.params + begin;
+        float* __restrict       second_moment = segment.second_moment + begin;
+        const float* __restrict nabla         = segment.nabla + begin;
+        float                   l1            = segment.regularize ? lambda_l1_over_n : 0.0f;
+        float                   l2            = segment.regularize ? lambda_l2_over_n : 0.0f;
+#pragma omp simd
+        for(size_t i = 0; i < size; ++i) {
+            float w = params[i];
+            float g = nabla[i] * one_over_length + l1 * sign(w) + l2 * w;
+            float s = rho * second_moment[i] + (1.0f - rho) * g * g;
+            second_moment[i] = s;
+            params[i]        = w - eta * g / (std::sqrt(s) + epsilon);
+        }
+    });
+    ++workspace.step;
+}
+
+void AdamOptimizer::step(Network& net, TrainingWorkspace& workspace, const HyperParameter& hy, float eta, size_t length, size_t n) {
+    std::array<ParameterSegment, 2> segments = trainable_segments(net, workspace);
+    ++workspace.step;
+
+    float beta1            = hy.beta1;
+    float beta2            = hy.beta2;
+    float epsilon          = hy.epsilon;
+    float one_over_length  = 1.0f / length;
+    float lambda_l1_over_n = hy.lambda_l1 / n;
+    float lambda_l2_over_n = hy.lambda_l2 / n;
+    // bias correction of moment estimates starting at 0
+    float bias_correction1 = 1.0f - std::pow(beta1, static_cast<float>(workspace.step));
+    float bias_correction2 = 1.0f - std::pow(beta2, static_cast<float>(workspace.step));
+    float step_size        = eta / bias_correction1;
+    float decay            = m_decoupled ? 1.0f - eta * hy.weight_decay : 1.0f;
+    for_each_block(segments.data(), segments.size(), [=](const ParameterSegment& segment, size_t begin, size_t size) {
+        float* __restrict       params        = segment.params + begin;
+        float* __restrict       velocity      = segment.velocity + begin;
+        float* __restrict       second_moment = segment.second_moment + begin;
+        const float* __restrict nabla         = segment.nabla + begin;
+        float                   l1            = segment.regularize ? lambda_l1_over_n : 0.0f;
+        float                   l2            = segment.regularize ? lambda_l2_over_n : 0.0f;
+        float                   seg_decay     = segment.regularize ? decay : 1.0f;
+#pragma omp simd
+        for(size_t i = 0; i < size; ++i) {
+            float w = params[i];
+            float g = nabla[i] * one_over_length + l1 * sign(w) + l2 * w;
+            float m = beta1 * velocity[i] + (1.0f - beta1) * g;
+            float s = beta2 * second_moment[i] + (1.0f - beta2) * g * g;
+            velocity[i]      = m;
+            second_moment[i] = s;
+            params[i]        = w * seg_decay - step_size * m / (std::sqrt(s / bias_correction2) + epsilon);
+        }
+    });
+}
+} // namespace NeuralNet
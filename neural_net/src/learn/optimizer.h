@@ -0,0 +1,90 @@
+#pragma once
+#include "net/net.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace NeuralNet {
+struct TrainingWorkspace;
+
+// contiguous run of parameters with optimizer state and gradient of the same size
+struct ParameterSegment {
+    float*       params;
+    float*       velocity;
+    // nullptr when not used by optimizer
+    float*       second_moment;
+    const float* nabla;
+    size_t       size;
+    // false -> no regularization and weight decay, e.g. for biases
+    bool regularize;
+};
+
+// single pass over parameter, velocity and gradient of each element
+// numerically equal to:
+//      velocity -= eta * lambda_l1 / n * sign(params)    <- only regularized segments
+//      velocity *= 1 - eta * lambda_l2 / n               <- only regularized segments
+//      velocity *= mu
+//      velocity -= eta / length * nabla
+//      params += velocity
+// segments get split into blocks that are processed in parallel when big enough
+void fused_momentum_update(const ParameterSegment* segments,
+                           size_t                  n_segments,
+                           float                   eta_over_length,
+                           float                   mu,
+                           float                   l1_step,
+                           float                   l2_scale);
+
+// updates parameters with gradient sums in workspace
+// state is stored in workspace; all updates are fused, allocation free and ignore the post process layer
+class Optimizer {
+public:
+    virtual ~Optimizer() = default;
+    // length = amount of data sets in mini batch
+    // n = amount of data sets in training data
+    virtual void step(Network& net, TrainingWorkspace& workspace, const HyperParameter& hy, float eta, size_t length, size_t n) = 0;
+    // RMSProp and Adam need second moment estimates
+    virtual bool uses_second_moment() { return false; }
+
+    virtual std::string to_str() = 0;
+
+    static std::shared_ptr<Optimizer> get(OptimizerType type);
+};
+
+// classical momentum with L1 and L2 applied to velocity
+class MomentumOptimizer: public Optimizer {
+public:
+    virtual void step(Network& net, TrainingWorkspace& workspace, const HyperParameter& hy, float eta, size_t length, size_t n) override;
+    virtual std::string to_str() override { return "momentum"; }
+};
+
+// look ahead momentum; L1 and L2 are part of the gradient
+class NesterovOptimizer: public Optimizer {
+public:
+    virtual void step(Network& net, TrainingWorkspace& workspace, const HyperParameter& hy, float eta, size_t length, size_t n) override;
+    virtual std::string to_str() override { return "nesterov"; }
+};
+
+// scale gradient by running average of its magnitude; L1 and L2 are part of the gradient
+class RMSPropOptimizer: public Optimizer {
+public:
+    virtual void step(Network& net, TrainingWorkspace& workspace, const HyperParameter& hy, float eta, size_t length, size_t n) override;
+    virtual bool        uses_second_moment() override { return true; }
+    virtual std::string to_str() override { return "rmsprop"; }
+};
+
+// bias corrected first and second moment estimates; L1 and L2 are part of the gradient
+// decoupled -> AdamW, weight decay is applied to parameters directly
+class AdamOptimizer: public Optimizer {
+private:
+    bool m_decoupled;
+
+public:
+    explicit AdamOptimizer(bool decoupled)
+        : m_decoupled(decoupled) {}
+
+    virtual void step(Network& net, TrainingWorkspace& workspace, const HyperParameter& hy, float eta, size_t length, size_t n) override;
+    virtual bool        uses_second_moment() override { return true; }
+    virtual std::string to_str() override { return m_decoupled ? "adamw" : "adam"; }
+};
+} // namespace NeuralNet
@@ -0,0 +1,69 @@
+#pragma once
+#include "learn/eval.h"
+#include "learn/optimizer.h"
+#include "net/net.h"
+#include "net/parameters.h"
+
+#include <memory>
+#include <random>
+
+namespace NeuralNet {
+// buffers reused for every mini batch
+// congruent to parameters of network
+struct TrainingWorkspace {
+    // sums of gradients of current mini batch
+    FlatParameters nabla;
+    // velocity of momentum-based optimizers, first moment estimate of Adam
+    FlatParameters velocity;
+    // second moment estimate of RMSProp and Adam; empty for other optimizers
+    FlatParameters second_moment;
+    // amount of optimizer steps taken so far
+    size_t step = 0;
+
+    std::shared_ptr<Optimizer> optimizer;
+
+    // subsample and in flight metrics of current epoch
+    TrainMonitor train_monitor;
+    // training cost since last divergence check, see HyperParameter::divergence_factor
+    InFlightMetrics check_cost;
+
+    TrainingWorkspace(const Network& net, const HyperParameter& hy)
+        : nabla(net.sizes), velocity(net.sizes), optimizer(Optimizer::get(hy.optimizer_type)), train_monitor(hy) {
+        if(optimizer->uses_second_moment())
+            second_moment.allocate(net.sizes);
+        check_cost.cost = hy.divergence_check_interval && hy.divergence_factor;
+    }
+};
+
+// everything besides the network needed to continue learning where sgd stopped
+// copy to fork learning into multiple branches
+struct TrainingState {
+    TrainingWorkspace workspace;
+    // current eta of accuracy based schedules
+    float eta;
+    // amount of finished epochs
+    size_t epoch = 0;
+    // gets reset after reducing eta
+    size_t epochs_since_last_reduction = 0;
+
+    // amount of mini batches trained so far
+    size_t batches = 0;
+    // nanoseconds of learning so far, continued by the next sgd call, see HyperParameter::learn_time
+    long long learn_time = 0;
+    // mean training cost up to first divergence check
+    float initial_check_cost = 0.0f;
+
+    // weights and biases of best epoch so far, see HyperParameter::best_weights_metric
+    arma::fvec best_flat;
+    float      best_score        = 0.0f;
+    // starting at 0, unlike HyperParameter::best_epoch
+    size_t     best_epoch        = 0;
+    size_t     epochs_since_best = 0;
+
+    // shuffles training data each epoch
+    std::mt19937 rng;
+
+    TrainingState(const Network& net, const HyperParameter& hy)
+        : workspace(net, hy), eta(hy.init_eta), rng(std::random_device {}()) {}
+};
+} // namespace NeuralNet
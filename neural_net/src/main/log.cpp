@@ -8,45 +8,70 @@ std::shared_ptr<spdlog::logger> Log::s_hyper_logger;
 std::shared_ptr<spdlog::logger> Log::s_client_logger;
 std::shared_ptr<spdlog::logger> Log::s_error_logger;
 
-void Log::init() {
+void Log::init(const LogConfig& config) {
     try {
         // log to console and file
         std::vector<spdlog::sink_ptr> default_log_sinks;
-        default_log_sinks.emplace_back(std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
-        default_log_sinks.emplace_back(std::make_shared<spdlog::sinks::basic_file_sink_mt>("neural_net.log", true));
+        if(config.console) {
+            default_log_sinks.emplace_back(std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
+            default_log_sinks.back()->set_pattern("%^[%T] %n: %v%$");
+        }
+        if(!config.file_path.empty()) {
+            default_log_sinks.emplace_back(std::make_shared<spdlog::sinks::basic_file_sink_mt>(config.file_path, config.truncate_file));
+            default_log_sinks.back()->set_pattern("[%T] [%l] %n: %v");
+        }
         // log to std error stream
         std::vector<spdlog::sink_ptr> error_log_sinks;
         error_log_sinks.emplace_back(std::make_shared<spdlog::sinks::stderr_color_sink_mt>());
-
-        default_log_sinks[0]->set_pattern("%^[%T] %n: %v%$");
-        default_log_sinks[1]->set_pattern("[%T] [%l] %n: %v");
         error_log_sinks[0]->set_pattern("%^[%T] %n: %v%$");
 
-        s_learn_logger =
-            std::make_shared<spdlog::logger>("Net Learn", begin(default_log_sinks), end(default_log_sinks));
-        s_hyper_logger =
-            std::make_shared<spdlog::logger>("Hyper Surfer", begin(default_log_sinks), end(default_log_sinks));
-        s_client_logger = std::make_shared<spdlog::logger>("Client", begin(default_log_sinks), end(default_log_sinks));
-        s_error_logger  = std::make_shared<spdlog::logger>("Error", begin(error_log_sinks), end(error_log_sinks));
-
-        spdlog::register_logger(s_learn_logger);
-        s_learn_logger->set_level(spdlog::level::trace);
-        s_learn_logger->flush_on(spdlog::level::trace);
+        auto create_logger = [&](const std::string& name) -> std::shared_ptr<spdlog::logger> {
+            if(!config.async)
+                return std::make_shared<spdlog::logger>(name, begin(default_log_sinks), end(default_log_sinks));
+            spdlog::async_overflow_policy overflow = config.overflow == LogOverflow::Block ? spdlog::async_overflow_policy::block
+                                                                                            : spdlog::async_overflow_policy::overrun_oldest;
+            return std::make_shared<spdlog::async_logger>(name, begin(default_log_sinks), end(default_log_sinks), spdlog::thread_pool(), overflow);
+        };
+        // all async loggers share one queue
+        if(config.async)
+            spdlog::init_thread_pool(std::max<size_t>(1, config.queue_size), std::max<size_t>(1, config.threads));
 
-        spdlog::register_logger(s_hyper_logger);
-        s_hyper_logger->set_level(spdlog::level::trace);
-        s_hyper_logger->flush_on(spdlog::level::trace);
+        s_learn_logger  = create_logger("Net Learn");
+        s_hyper_logger  = create_logger("Hyper Surfer");
+        s_client_logger = create_logger("Client");
+        s_error_logger  = std::make_shared<spdlog::logger>("Error", begin(error_log_sinks), end(error_log_sinks));
 
-        spdlog::register_logger(s_client_logger);
-        s_client_logger->set_level(spdlog::level::trace);
-        s_client_logger->flush_on(spdlog::level::trace);
+        for(const std::shared_ptr<spdlog::logger>& logger: {s_learn_logger, s_hyper_logger, s_client_logger}) {
+            spdlog::register_logger(logger);
+            logger->set_level(spdlog::level::trace);
+            logger->flush_on(static_cast<spdlog::level::level_enum>(config.flush_level));
+        }
 
         spdlog::register_logger(s_error_logger);
         s_error_logger->set_level(spdlog::level::critical);
         s_error_logger->flush_on(spdlog::level::critical);
+
+        if(config.flush_seconds)
+            spdlog::flush_every(std::chrono::seconds(config.flush_seconds));
+        // after the spdlog registry has been created <- runs before its destructor
+        // once, even when init gets called again
+        static bool registered = false;
+        if(!registered)
+            registered = !std::atexit(shutdown);
     } catch(const spdlog::spdlog_ex& ex) {
         std::cerr << "Log init failed: " << ex.what() << std::endl;
         std::exit(EXIT_FAILURE);
     }
 }
+
+void Log::flush() {
+    for(const std::shared_ptr<spdlog::logger>& logger: {s_learn_logger, s_hyper_logger, s_client_logger, s_error_logger})
+        if(logger)
+            logger->flush();
+}
+
+void Log::shutdown() {
+    flush();
+    spdlog::shutdown();
+}
 } // namespace NeuralNet
@@ -1,6 +1,7 @@
 #pragma once
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
+#include <string>
 
 namespace NeuralNet {
 enum class LogLevel {
@@ -10,6 +11,34 @@ enum class LogLevel {
     Error   = spdlog::level::err
 };
 
+// what async loggers do when their queue is full
+enum class LogOverflow {
+    // wait for the logging thread <- no message lost
+    Block,
+    // replace the oldest queued message <- never stalls training
+    OverrunOldest
+};
+
+// sinks, flushing and threading of the learn, hyper and client loggers
+// the error logger always writes synchronously to std::cerr
+struct LogConfig {
+    bool console = true;
+    // empty -> no file sink
+    std::string file_path     = "neural_net.log";
+    bool        truncate_file = true;
+
+    // format and write messages in a background thread
+    bool        async      = false;
+    size_t      queue_size = 8192;
+    size_t      threads    = 1;
+    LogOverflow overflow   = LogOverflow::Block;
+
+    // flush immediately at and above this level
+    LogLevel flush_level = LogLevel::Warn;
+    // flush all loggers periodically; 0 -> only flush_level
+    size_t flush_seconds = 1;
+};
+
 class Log {
 private:
     // std::cout and file
@@ -20,7 +49,13 @@ private:
     static std::shared_ptr<spdlog::logger> s_error_logger;
 
 public:
-    static void init();
+    // registers shutdown with std::atexit
+    static void init(const LogConfig& config = {});
+    // safe from any thread; async loggers flush in their logging thread
+    static void flush();
+    // flush everything and stop the logging threads
+    // runs at exit <- no other thread may log anymore
+    static void shutdown();
 
     static std::shared_ptr<spdlog::logger>& get_learn_logger() { return s_learn_logger; }
     static std::shared_ptr<spdlog::logger>& get_hyper_logger() { return s_hyper_logger; }
@@ -43,12 +78,14 @@ public:
     do {                                                                                                   \
         ::NeuralNet::Log::get_error_logger()->critical(__VA_ARGS__);                                       \
         ::NeuralNet::Log::get_error_logger()->critical("(in {}:{}; in function: {})", __FILE__, __func__); \
+        ::NeuralNet::Log::flush();                                                                         \
         std::exit(EXIT_FAILURE);                                                                           \
     } while(0)
 #else
 #define raise_critical(...)                                          \
     do {                                                             \
         ::NeuralNet::Log::get_error_logger()->critical(__VA_ARGS__); \
+        ::NeuralNet::Log::flush();                                   \
         std::exit(EXIT_FAILURE);                                     \
     } while(0)
 #endif
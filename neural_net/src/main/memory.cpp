@@ -0,0 +1,65 @@
+#include "memory.h"
+
+#include "pch.h"
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+// after windows.h
+#include <psapi.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#endif
+
+#include <fstream>
+
+namespace NeuralNet {
+size_t peak_rss() {
+#if defined(_WIN32) || defined(_WIN64)
+    PROCESS_MEMORY_COUNTERS counters;
+    if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return counters.PeakWorkingSetSize;
+#elif defined(__unix__) || defined(__APPLE__)
+    rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage))
+        return 0;
+#if defined(__APPLE__)
+    // bytes
+    return usage.ru_maxrss;
+#else
+    // kilobytes
+    return usage.ru_maxrss * 1024;
+#endif
+#else
+    return 0;
+#endif
+}
+
+size_t current_rss() {
+#if defined(_WIN32) || defined(_WIN64)
+    PROCESS_MEMORY_COUNTERS counters;
+    if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return counters.WorkingSetSize;
+#elif defined(__APPLE__)
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t      count = MACH_TASK_BASIC_INFO_COUNT;
+    if(task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS)
+        return 0;
+    return info.resident_size;
+#elif defined(__linux__)
+    // total and resident pages
+    std::ifstream statm("/proc/self/statm");
+    size_t        total_pages, resident_pages;
+    if(!(statm >> total_pages >> resident_pages))
+        return 0;
+    return resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#else
+    return 0;
+#endif
+}
+} // namespace NeuralNet
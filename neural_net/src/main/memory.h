@@ -0,0 +1,12 @@
+#pragma once
+#include <cstddef>
+
+namespace NeuralNet {
+// highest resident set size of this process so far in bytes
+// 0 -> unknown on this platform
+size_t peak_rss();
+
+// current resident set size of this process in bytes
+// 0 -> unknown on this platform
+size_t current_rss();
+} // namespace NeuralNet
@@ -0,0 +1,154 @@
+#include "profiler.h"
+
+#include "pch.h"
+
+#include <fstream>
+#include <functional>
+#include <thread>
+
+namespace NeuralNet {
+std::atomic<bool> Profiler::s_enabled {false};
+std::atomic<bool> Profiler::s_tracing {false};
+
+std::array<std::atomic<long long>, static_cast<size_t>(ProfilePhase::Count) * Profiler::s_max_index> Profiler::s_ns {};
+std::array<std::atomic<size_t>, static_cast<size_t>(ProfilePhase::Count) * Profiler::s_max_index>    Profiler::s_calls {};
+
+std::chrono::steady_clock::time_point Profiler::s_origin;
+std::chrono::steady_clock::time_point Profiler::s_last_collect;
+
+std::mutex              Profiler::s_trace_mutex;
+std::vector<TraceEvent> Profiler::s_trace;
+
+const char* to_str(ProfilePhase phase) {
+    switch(phase) {
+    case ProfilePhase::Shuffle:
+        return "shuffle";
+    case ProfilePhase::Gather:
+        return "gather";
+    case ProfilePhase::Forward:
+        return "forward";
+    case ProfilePhase::CostError:
+        return "cost_error";
+    case ProfilePhase::Backward:
+        return "backward";
+    case ProfilePhase::Optimizer:
+        return "optimizer";
+    case ProfilePhase::MonitorTestCost:
+        return "monitor_test_cost";
+    case ProfilePhase::MonitorTestAccuracy:
+        return "monitor_test_accuracy";
+    case ProfilePhase::MonitorEvalCost:
+        return "monitor_eval_cost";
+    case ProfilePhase::MonitorEvalAccuracy:
+        return "monitor_eval_accuracy";
+    case ProfilePhase::MonitorTrainCost:
+        return "monitor_train_cost";
+    case ProfilePhase::MonitorTrainAccuracy:
+        return "monitor_train_accuracy";
+    case ProfilePhase::AllReduce:
+        return "all_reduce";
+    case ProfilePhase::Count:
+        break;
+    }
+    return "unknown";
+}
+
+void Profiler::enable(bool trace) {
+#ifndef NEURAL_NET_PROFILE
+    log_learn_warn("Profiling requested but neural_net has been compiled without NEURAL_NET_PROFILE.");
+#endif
+    for(size_t slot = 0; slot < s_ns.size(); ++slot) {
+        s_ns[slot]    = 0;
+        s_calls[slot] = 0;
+    }
+    {
+        std::lock_guard<std::mutex> lock(s_trace_mutex);
+        s_trace.clear();
+    }
+    s_origin       = std::chrono::steady_clock::now();
+    s_last_collect = s_origin;
+    s_tracing      = trace;
+    s_enabled      = true;
+}
+
+void Profiler::disable() {
+    s_enabled = false;
+    s_tracing = false;
+}
+
+void Profiler::add(ProfilePhase phase, size_t index, std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end) {
+    long long ns   = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+    size_t    slot = static_cast<size_t>(phase) * s_max_index + std::min(index, s_max_index - 1);
+    s_ns[slot].fetch_add(ns, std::memory_order_relaxed);
+    s_calls[slot].fetch_add(1, std::memory_order_relaxed);
+
+    if(!s_tracing.load(std::memory_order_relaxed))
+        return;
+    std::lock_guard<std::mutex> lock(s_trace_mutex);
+    if(s_trace.size() >= s_max_trace_events) {
+        log_learn_warn("Trace is full after {} events; tracing stopped", s_trace.size());
+        s_tracing = false;
+        return;
+    }
+    s_trace.push_back({phase,
+                       index,
+                       std::chrono::duration<double, std::micro>(begin - s_origin).count(),
+                       std::chrono::duration<double, std::micro>(end - begin).count(),
+                       std::hash<std::thread::id>()(std::this_thread::get_id())});
+}
+
+EpochProfile Profiler::collect_epoch() {
+    auto         now = std::chrono::steady_clock::now();
+    EpochProfile profile;
+    profile.wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now - s_last_collect).count();
+    s_last_collect  = now;
+    for(size_t slot = 0; slot < s_ns.size(); ++slot) {
+        size_t calls = s_calls[slot].exchange(0);
+        if(!calls)
+            continue;
+        profile.timings.push_back({static_cast<ProfilePhase>(slot / s_max_index), slot % s_max_index, s_ns[slot].exchange(0), calls});
+    }
+    return profile;
+}
+
+void Profiler::save_chrome_trace(const std::string& path) {
+    json events = json::array();
+    {
+        std::lock_guard<std::mutex> lock(s_trace_mutex);
+        for(const TraceEvent& event: s_trace) {
+            std::string name = to_str(event.phase);
+            if(event.phase == ProfilePhase::Forward || event.phase == ProfilePhase::Backward)
+                name += "_" + std::to_string(event.index);
+            // complete events
+            events.push_back({{"name", name},
+                              {"cat", "train"},
+                              {"ph", "X"},
+                              {"ts", event.begin_us},
+                              {"dur", event.duration_us},
+                              {"pid", 0},
+                              {"tid", event.thread}});
+        }
+    }
+    std::ofstream file(path);
+    if(!file)
+        raise_critical("Can't open trace file '{}'!", path);
+    file << json {{"traceEvents", events}, {"displayTimeUnit", "ms"}};
+}
+
+void save_json(const std::vector<EpochProfile>& profiles, const std::string& path) {
+    json json_epochs = json::array();
+    for(const EpochProfile& profile: profiles) {
+        json json_timings = json::array();
+        for(const PhaseTiming& timing: profile.timings)
+            json_timings.push_back({{"phase", to_str(timing.phase)},
+                                    {"index", timing.index},
+                                    {"ns", timing.ns},
+                                    {"calls", timing.calls}});
+        json_epochs.push_back({{"wall_ns", profile.wall_ns}, {"timings", json_timings}});
+    }
+    std::ofstream file(path);
+    if(!file)
+        raise_critical("Can't open profile file '{}'!", path);
+    file << json {{"epochs", json_epochs}}.dump(4) << std::endl;
+}
+} // namespace NeuralNet
@@ -0,0 +1,126 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace NeuralNet {
+// parts of training measured by NN_PROFILE_SCOPE
+// Forward and Backward are measured per layer, all others use index 0
+enum class ProfilePhase : uint8_t { Shuffle = 0,
+                                    Gather,
+                                    Forward,
+                                    CostError,
+                                    Backward,
+                                    Optimizer,
+                                    MonitorTestCost,
+                                    MonitorTestAccuracy,
+                                    MonitorEvalCost,
+                                    MonitorEvalAccuracy,
+                                    MonitorTrainCost,
+                                    MonitorTrainAccuracy,
+                                    AllReduce,
+                                    Count };
+
+const char* to_str(ProfilePhase phase);
+
+// time spent in one phase
+struct PhaseTiming {
+    ProfilePhase phase;
+    // layer of Forward and Backward
+    size_t    index;
+    long long ns;
+    size_t    calls;
+};
+
+// breakdown of one epoch
+struct EpochProfile {
+    // only phases that have been entered
+    std::vector<PhaseTiming> timings;
+    // time since previous epoch's profile has been collected <- includes everything not measured
+    long long wall_ns = 0;
+};
+
+// one finished scope in chrome trace event format
+struct TraceEvent {
+    ProfilePhase phase;
+    size_t       index;
+    // microseconds since profiler got enabled
+    double begin_us;
+    double duration_us;
+    size_t thread;
+};
+
+// collects timings of all threads
+// compiled in with NEURAL_NET_PROFILE, otherwise NN_PROFILE_SCOPE does nothing
+class Profiler {
+private:
+    // layers with more indices share the last slot
+    static constexpr size_t s_max_index = 32;
+    // bounds memory of traces
+    static constexpr size_t s_max_trace_events = 1 << 20;
+
+    static std::atomic<bool> s_enabled;
+    static std::atomic<bool> s_tracing;
+
+    static std::array<std::atomic<long long>, static_cast<size_t>(ProfilePhase::Count) * s_max_index> s_ns;
+    static std::array<std::atomic<size_t>, static_cast<size_t>(ProfilePhase::Count) * s_max_index>    s_calls;
+
+    static std::chrono::steady_clock::time_point s_origin;
+    static std::chrono::steady_clock::time_point s_last_collect;
+
+    static std::mutex              s_trace_mutex;
+    static std::vector<TraceEvent> s_trace;
+
+public:
+    // clears timings and trace
+    // trace -> additionally record every scope for save_chrome_trace
+    static void enable(bool trace = false);
+    static void disable();
+    static bool enabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+    static void add(ProfilePhase phase, size_t index, std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end);
+
+    // timings since last collect; resets them
+    static EpochProfile collect_epoch();
+
+    // load in chrome://tracing or perfetto
+    static void save_chrome_trace(const std::string& path);
+};
+
+// adds its lifetime to the profiler when enabled
+class ProfileScope {
+private:
+    ProfilePhase                          m_phase;
+    size_t                                m_index;
+    bool                                  m_active;
+    std::chrono::steady_clock::time_point m_begin;
+
+public:
+    ProfileScope(ProfilePhase phase, size_t index)
+        : m_phase(phase), m_index(index), m_active(Profiler::enabled()) {
+        if(m_active)
+            m_begin = std::chrono::steady_clock::now();
+    }
+    ~ProfileScope() {
+        if(m_active)
+            Profiler::add(m_phase, m_index, m_begin, std::chrono::steady_clock::now());
+    }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+// nanoseconds and calls of each phase per epoch
+void save_json(const std::vector<EpochProfile>& profiles, const std::string& path);
+} // namespace NeuralNet
+
+#define NN_PROFILE_CONCAT_INNER(a, b) a##b
+#define NN_PROFILE_CONCAT(a, b)       NN_PROFILE_CONCAT_INNER(a, b)
+#ifdef NEURAL_NET_PROFILE
+#define NN_PROFILE_SCOPE(phase, index) ::NeuralNet::ProfileScope NN_PROFILE_CONCAT(nn_profile_scope_, __LINE__)(phase, index)
+#else
+#define NN_PROFILE_SCOPE(phase, index)
+#endif
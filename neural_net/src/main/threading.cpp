@@ -0,0 +1,116 @@
+#include "threading.h"
+
+#include "pch.h"
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <thread>
+
+// thread setters of common BLAS backends
+// weak -> null when armadillo links against a different backend
+#if defined(__linux__) && defined(__GNUC__)
+extern "C" void openblas_set_num_threads(int) __attribute__((weak));
+extern "C" void MKL_Set_Num_Threads(int) __attribute__((weak));
+extern "C" void bli_thread_set_num_threads(long) __attribute__((weak));
+#endif
+
+namespace NeuralNet {
+ThreadingPolicy Threading::s_policy;
+
+size_t Threading::available_cores() {
+#if defined(__linux__)
+    cpu_set_t set;
+    if(!sched_getaffinity(0, sizeof(set), &set))
+        return std::max(1, CPU_COUNT(&set));
+#endif
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+ThreadingPolicy Threading::resolve(const ThreadingPolicy& policy, size_t n_available_cores) {
+    ThreadingPolicy resolved = policy;
+    if(!resolved.cores || resolved.cores > n_available_cores)
+        resolved.cores = n_available_cores;
+    if(!resolved.openmp_threads && !resolved.blas_threads)
+        resolved.openmp_threads = resolved.cores;
+    if(!resolved.openmp_threads)
+        resolved.openmp_threads = std::max<size_t>(1, resolved.cores / resolved.blas_threads);
+    if(!resolved.blas_threads)
+        resolved.blas_threads = std::max<size_t>(1, resolved.cores / resolved.openmp_threads);
+    return resolved;
+}
+
+// returns name of the backend that has been set
+static std::string set_blas_threads(size_t threads) {
+#if defined(__linux__) && defined(__GNUC__)
+    if(openblas_set_num_threads) {
+        openblas_set_num_threads(static_cast<int>(threads));
+        return "OpenBLAS";
+    }
+    if(MKL_Set_Num_Threads) {
+        MKL_Set_Num_Threads(static_cast<int>(threads));
+        return "MKL";
+    }
+    if(bli_thread_set_num_threads) {
+        bli_thread_set_num_threads(static_cast<long>(threads));
+        return "BLIS";
+    }
+#else
+    (void)threads;
+#endif
+    return "unknown";
+}
+
+// keep this process on the first cores it may use
+// threads started later inherit the mask
+static bool pin(size_t cores) {
+#if defined(__linux__)
+    cpu_set_t available;
+    if(sched_getaffinity(0, sizeof(available), &available))
+        return false;
+    cpu_set_t pinned;
+    CPU_ZERO(&pinned);
+    size_t n_pinned = 0;
+    for(int cpu = 0; cpu < CPU_SETSIZE && n_pinned < cores; ++cpu)
+        if(CPU_ISSET(cpu, &available)) {
+            CPU_SET(cpu, &pinned);
+            ++n_pinned;
+        }
+    return !sched_setaffinity(0, sizeof(pinned), &pinned);
+#else
+    (void)cores;
+    return false;
+#endif
+}
+
+void Threading::init(const ThreadingPolicy& policy) {
+    s_policy = resolve(policy, available_cores());
+    if(s_policy.openmp_threads * s_policy.blas_threads > s_policy.cores)
+        log_learn_warn("{} OpenMP threads with {} BLAS threads each oversubscribe {} cores",
+                       s_policy.openmp_threads, s_policy.blas_threads, s_policy.cores);
+
+    if(s_policy.pin_threads && !pin(s_policy.cores)) {
+        log_learn_warn("Pinning to {} cores isn't supported on this platform", s_policy.cores);
+        s_policy.pin_threads = false;
+    }
+
+#ifdef _OPENMP
+    omp_set_num_threads(static_cast<int>(s_policy.openmp_threads));
+#else
+    log_learn_extra("neural_net has been compiled without OpenMP; parameter updates are single threaded");
+#endif
+
+    std::string blas_backend = set_blas_threads(s_policy.blas_threads);
+    if(blas_backend == "unknown")
+        log_learn_warn("Can't set threads of the BLAS backend; use its environment variable, e.g. OPENBLAS_NUM_THREADS={}",
+                       s_policy.blas_threads);
+
+    log_learn_general("Threading: {} cores; {} OpenMP threads; {} {} threads; {}",
+                      s_policy.cores, s_policy.openmp_threads, s_policy.blas_threads, blas_backend,
+                      s_policy.pin_threads ? "pinned" : "not pinned");
+}
+} // namespace NeuralNet
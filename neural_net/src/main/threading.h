@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+
+namespace NeuralNet {
+// how the cores of this process are split between the OpenMP regions of neural_net and the BLAS backend of armadillo
+// both run at the same time as soon as OpenMP regions call BLAS
+// std::threads of neural_net, e.g. AsyncMonitor, CheckpointWriter and async logging, aren't part of the budget
+struct ThreadingPolicy {
+    // total budget; 0 -> all cores this process may run on
+    size_t cores = 0;
+    // threads of OpenMP regions, e.g. parameter updates; 0 -> cores / blas_threads
+    size_t openmp_threads = 0;
+    // threads of one BLAS call; 0 -> cores / openmp_threads
+    // small networks get slower with multi threaded BLAS
+    size_t blas_threads = 1;
+    // restrict this process to the first cores of the budget <- only on linux
+    bool pin_threads = false;
+};
+
+// applies a ThreadingPolicy once
+class Threading {
+private:
+    // with all 0 resolved
+    static ThreadingPolicy s_policy;
+
+public:
+    // call after Log::init; logs the resolved configuration
+    static void init(const ThreadingPolicy& policy = {});
+
+    static const ThreadingPolicy& get_policy() { return s_policy; }
+    static size_t                 get_openmp_threads() { return s_policy.openmp_threads; }
+    static size_t                 get_blas_threads() { return s_policy.blas_threads; }
+
+    // fill in all 0 of the policy
+    static ThreadingPolicy resolve(const ThreadingPolicy& policy, size_t n_available_cores);
+    // cores this process may run on
+    static size_t available_cores();
+};
+} // namespace NeuralNet
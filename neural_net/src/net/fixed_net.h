@@ -0,0 +1,201 @@
+#pragma once
+#include "learn/evaluator.h"
+#include "net/net.h"
+#include "net/setup.h"
+
+#include <array>
+#include <cmath>
+#include <functional>
+#include <string>
+#include <utility>
+
+namespace NeuralNet {
+enum class FixedCostType : uint8_t { Quadratic = 0,
+                                     CrossEntropy };
+
+namespace FixedDetail {
+// amount of weights of all layers left of layer_idx
+template<size_t N>
+constexpr size_t weight_offset(const std::array<size_t, N>& sizes, size_t layer_idx) {
+    size_t offset = 0;
+    for(size_t i = 0; i < layer_idx; ++i)
+        offset += sizes[i] * sizes[i + 1];
+    return offset;
+}
+// amount of neurons in all layers left of layer_idx
+template<size_t N>
+constexpr size_t neuron_offset(const std::array<size_t, N>& sizes, size_t layer_idx) {
+    size_t offset = 0;
+    for(size_t i = 0; i < layer_idx; ++i)
+        offset += sizes[i];
+    return offset;
+}
+} // namespace FixedDetail
+
+// network with layer sizes known at compile time
+// everything is stored inline <- no heap allocations, no virtual calls
+// meant for tiny models like {3, 100, 100, 12}; big networks should use Network
+template<size_t... Sizes>
+struct FixedNetwork {
+    static_assert(sizeof...(Sizes) >= 2, "a network needs at least an input and an output layer");
+
+    static constexpr size_t                        num_layers = sizeof...(Sizes);
+    static constexpr std::array<size_t, num_layers> sizes {Sizes...};
+    // all weights and biases of all layers
+    static constexpr size_t n_weights = FixedDetail::weight_offset(sizes, num_layers - 1);
+    static constexpr size_t n_biases  = FixedDetail::neuron_offset(sizes, num_layers) - sizes[0];
+    // all neurons including input layer
+    static constexpr size_t n_neurons = FixedDetail::neuron_offset(sizes, num_layers);
+
+    // offset of weights between left_layer_idx-th and left_layer_idx+1-th layer
+    static constexpr size_t weight_offset(size_t left_layer_idx) {
+        return FixedDetail::weight_offset(sizes, left_layer_idx);
+    }
+    // offset of biases of layer_idx-th layer, input layer doesn't have any
+    static constexpr size_t bias_offset(size_t layer_idx) {
+        return FixedDetail::neuron_offset(sizes, layer_idx) - sizes[0];
+    }
+    // offset of activations of layer_idx-th layer
+    static constexpr size_t neuron_offset(size_t layer_idx) {
+        return FixedDetail::neuron_offset(sizes, layer_idx);
+    }
+
+    // column-major, congruent to Network::weights
+    // w_(j,k) = weights[weight_offset(l) + k * sizes[l + 1] + j]
+    alignas(32) std::array<float, n_weights> weights {};
+    alignas(32) std::array<float, n_biases> biases {};
+
+    std::function<float(const arma::fvec& y, const arma::fvec& a)> evaluator = DefaultEvaluater::classifier;
+
+    FixedCostType cost_type = FixedCostType::CrossEntropy;
+
+    // true -> last layer is post process layer <- this layer won't be changed by learning algorithm
+    bool post_process = false;
+};
+
+// sizes have to match
+template<size_t... Sizes>
+void from_network(FixedNetwork<Sizes...>& fixed, const Network& net) {
+    using Fixed = FixedNetwork<Sizes...>;
+    if(net.sizes.size() != Fixed::num_layers)
+        raise_critical("Can't convert {} to fixed network with {} layers.", net.to_str(), Fixed::num_layers);
+    for(size_t layer_idx = 0; layer_idx < Fixed::num_layers; ++layer_idx)
+        if(net.sizes[layer_idx] != Fixed::sizes[layer_idx])
+            raise_critical("Can't convert {} to fixed network; layer {} has wrong size.", net.to_str(), layer_idx);
+    if(std::find(net.linear_layers.begin(), net.linear_layers.end(), true) != net.linear_layers.end())
+        raise_critical("Fixed networks don't support linear layers.");
+    // fixed updates don't apply the mask <- pruned weights would grow back
+    if(net.weight_mask.n_elem)
+        raise_critical("Fixed networks don't support pruned networks with a weight mask.");
+
+    for(size_t left_layer_idx = 0; left_layer_idx < Fixed::num_layers - 1; ++left_layer_idx) {
+        const arma::fmat& w = net.weights[left_layer_idx];
+        std::copy(w.memptr(), w.memptr() + w.n_elem, fixed.weights.begin() + Fixed::weight_offset(left_layer_idx));
+        const arma::fvec& b = net.biases[left_layer_idx];
+        std::copy(b.memptr(), b.memptr() + b.n_elem, fixed.biases.begin() + Fixed::bias_offset(left_layer_idx + 1));
+    }
+
+    if(net.cost->to_str() == "quadratic")
+        fixed.cost_type = FixedCostType::Quadratic;
+    else if(net.cost->to_str() == "cross_entropy")
+        fixed.cost_type = FixedCostType::CrossEntropy;
+    else
+        raise_critical("Cost function '{}' isn't supported by fixed networks.", net.cost->to_str());
+
+    fixed.evaluator    = net.evaluator;
+    fixed.post_process = net.post_process;
+}
+
+// net gets overwritten
+template<size_t... Sizes>
+void to_network(const FixedNetwork<Sizes...>& fixed, Network& net) {
+    using Fixed = FixedNetwork<Sizes...>;
+    // only reallocate when necessary
+    if(net.sizes != std::vector<size_t>(Fixed::sizes.begin(), Fixed::sizes.end())) {
+        net.num_layers = Fixed::num_layers;
+        net.sizes      = std::vector<size_t>(Fixed::sizes.begin(), Fixed::sizes.end());
+        null_weight_init(net);
+    }
+
+    for(size_t left_layer_idx = 0; left_layer_idx < Fixed::num_layers - 1; ++left_layer_idx) {
+        arma::fmat&  w     = net.weights[left_layer_idx];
+        const float* w_src = fixed.weights.data() + Fixed::weight_offset(left_layer_idx);
+        std::copy(w_src, w_src + w.n_elem, w.memptr());
+        arma::fvec&  b     = net.biases[left_layer_idx];
+        const float* b_src = fixed.biases.data() + Fixed::bias_offset(left_layer_idx + 1);
+        std::copy(b_src, b_src + b.n_elem, b.memptr());
+    }
+
+    net.cost         = Cost::get(fixed.cost_type == FixedCostType::Quadratic ? "quadratic" : "cross_entropy");
+    net.evaluator    = fixed.evaluator;
+    net.post_process = fixed.post_process;
+    net.linear_layers.clear();
+}
+
+// same format as dynamic networks
+template<size_t... Sizes>
+void load_json_network(FixedNetwork<Sizes...>& fixed, const std::string& json_path) {
+    Network net;
+    load_json_network(net, json_path);
+    from_network(fixed, net);
+}
+
+template<size_t... Sizes>
+void save_json(const FixedNetwork<Sizes...>& fixed, const std::string& path) {
+    Network net;
+    to_network(fixed, net);
+    save_json(net, path);
+}
+
+// sizes[Layer] x sizes[Layer + 1] kernel <- fully unrolled by the compiler
+// z = w * a + b; a_out = sigmoid(z)
+template<size_t Layer, size_t... Sizes>
+inline void fixed_forward_layer(const FixedNetwork<Sizes...>& net, const float* a, float* z, float* a_out) {
+    using Fixed       = FixedNetwork<Sizes...>;
+    constexpr size_t in  = Fixed::sizes[Layer];
+    constexpr size_t out = Fixed::sizes[Layer + 1];
+    const float*     w   = net.weights.data() + Fixed::weight_offset(Layer);
+    const float*     b   = net.biases.data() + Fixed::bias_offset(Layer + 1);
+
+    for(size_t j = 0; j < out; ++j)
+        z[j] = b[j];
+    // go column by column <- contiguous memory
+    for(size_t k = 0; k < in; ++k) {
+        const float  a_k = a[k];
+        const float* w_k = w + k * out;
+        for(size_t j = 0; j < out; ++j)
+            z[j] += w_k[j] * a_k;
+    }
+    for(size_t j = 0; j < out; ++j)
+        a_out[j] = 1.0f / (1.0f + std::exp(-z[j]));
+}
+
+template<size_t... Sizes, size_t... Layers>
+inline void fixed_feedforward(const FixedNetwork<Sizes...>& net, float* zs, float* activations, std::index_sequence<Layers...>) {
+    using Fixed = FixedNetwork<Sizes...>;
+    (fixed_forward_layer<Layers>(net,
+                                 activations + Fixed::neuron_offset(Layers),
+                                 zs + Fixed::neuron_offset(Layers + 1) - Fixed::sizes[0],
+                                 activations + Fixed::neuron_offset(Layers + 1)),
+     ...);
+}
+
+// activations[0, sizes[0]) have to hold the input
+// zs and activations get filled layer by layer; zs has no entries for the input layer
+template<size_t... Sizes>
+inline void fixed_feedforward(const FixedNetwork<Sizes...>& net, float* zs, float* activations) {
+    fixed_feedforward(net, zs, activations, std::make_index_sequence<sizeof...(Sizes) - 1>());
+}
+
+// return output of network with input a
+template<size_t... Sizes>
+arma::fvec feedforward(const FixedNetwork<Sizes...>& net, const float* a) {
+    using Fixed = FixedNetwork<Sizes...>;
+    alignas(32) std::array<float, Fixed::n_neurons> activations;
+    alignas(32) std::array<float, Fixed::n_biases>  zs;
+    std::copy(a, a + Fixed::sizes[0], activations.begin());
+    fixed_feedforward(net, zs.data(), activations.data());
+    const float* out = activations.data() + Fixed::neuron_offset(Fixed::num_layers - 1);
+    return arma::fvec(out, Fixed::sizes[Fixed::num_layers - 1]);
+}
+} // namespace NeuralNet
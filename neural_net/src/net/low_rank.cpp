@@ -0,0 +1,153 @@
+#include "low_rank.h"
+
+#include "learn/eval.h"
+#include "pch.h"
+
+#include <chrono>
+
+namespace NeuralNet {
+// weights = u * diagmat(s) * v.t()
+struct Svd {
+    arma::fmat u;
+    arma::fvec s;
+    arma::fmat v;
+};
+
+static Svd svd(const arma::fmat& weights) {
+    Svd result;
+    if(!arma::svd_econ(result.u, result.s, result.v, weights))
+        raise_critical("Singular value decomposition of {}x{} weights failed.", weights.n_rows, weights.n_cols);
+    return result;
+}
+
+// replace weights[left_layer_idx] with two layers around a linear bottleneck of rank neurons
+static void insert_factorization(Network& net, size_t left_layer_idx, const Svd& svd, size_t rank) {
+    std::vector<size_t> sizes = net.sizes;
+    sizes.insert(sizes.begin() + left_layer_idx + 1, rank);
+    FlatParameters factorized(sizes);
+    for(size_t idx = 0; idx < net.weights.size(); ++idx) {
+        if(idx == left_layer_idx)
+            continue;
+        // layers behind bottleneck move one back
+        size_t target              = idx < left_layer_idx ? idx : idx + 1;
+        factorized.weights[target] = net.weights[idx];
+        factorized.biases[target]  = net.biases[idx];
+    }
+    // split singular values evenly <- similar scales for fine-tuning
+    arma::fmat sqrt_s                      = arma::diagmat(arma::sqrt(svd.s.head(rank)));
+    factorized.weights[left_layer_idx]     = sqrt_s * svd.v.cols(0, rank - 1).t();
+    factorized.weights[left_layer_idx + 1] = svd.u.cols(0, rank - 1) * sqrt_s;
+    factorized.biases[left_layer_idx + 1]  = net.biases[left_layer_idx];
+    // bottleneck bias starts at 0 <- same output
+
+    if(net.linear_layers.empty())
+        net.linear_layers.resize(net.num_layers, false);
+    net.linear_layers.insert(net.linear_layers.begin() + left_layer_idx + 1, true);
+    // views get bound to the new buffer
+    static_cast<FlatParameters&>(net) = factorized;
+    net.sizes                         = sizes;
+    net.num_layers                    = sizes.size();
+}
+
+// smallest rank keeping energy of the squared singular values
+static size_t energy_rank(const arma::fvec& s, float energy) {
+    double total = 0.0;
+    for(float value: s)
+        total += static_cast<double>(value) * value;
+    double kept = 0.0;
+    for(size_t rank = 1; rank <= s.n_elem; ++rank) {
+        kept += static_cast<double>(s(rank - 1)) * s(rank - 1);
+        if(kept >= energy * total)
+            return rank;
+    }
+    return s.n_elem;
+}
+
+// fraction of correct results
+static float accuracy(const Network& net, const Data& data) {
+    return total_accuracy(net, &data, net.evaluator) / data.get_x().n_cols;
+}
+
+// smallest rank not losing more than max_drop of accuracy
+// binary search <- accuracy grows roughly monotonically with rank
+static size_t accuracy_rank(const Network& net, size_t left_layer_idx, const Svd& svd, const Data& data, float max_drop) {
+    float  target = accuracy(net, data) - max_drop;
+    size_t low    = 1;
+    size_t high   = svd.s.n_elem;
+    while(low < high) {
+        size_t  rank = (low + high) / 2;
+        Network candidate(net);
+        insert_factorization(candidate, left_layer_idx, svd, rank);
+        if(accuracy(candidate, data) >= target)
+            high = rank;
+        else
+            low = rank + 1;
+    }
+    return low;
+}
+
+// best of a few feedforward passes over data
+static double feedforward_seconds(const Network& net, const Data& data) {
+    arma::fmat x    = data.get_x();
+    double     best = std::numeric_limits<double>::max();
+    for(int run = 0; run < 3; ++run) {
+        auto begin = std::chrono::steady_clock::now();
+        feedforward(net, x);
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+    }
+    return best;
+}
+
+void factorize_layer(Network& net, size_t left_layer_idx, size_t rank) {
+    if(left_layer_idx >= net.weights.size() - net.post_process)
+        raise_critical("Can't factorize weights of layer {}.", left_layer_idx);
+    const arma::fmat& weights = net.weights[left_layer_idx];
+    if(!rank || rank > std::min(weights.n_rows, weights.n_cols))
+        raise_critical("Rank {} is invalid for {}x{} weights.", rank, weights.n_rows, weights.n_cols);
+    insert_factorization(net, left_layer_idx, svd(weights), rank);
+}
+
+LowRankReport factorize_low_rank(Network& net, const LowRankConfig& config, const Data& eval_data) {
+    if(net.weight_mask.n_elem) {
+        log_learn_warn("Factorizing a pruned network; pruned weights won't stay 0");
+        net.weight_mask.reset();
+    }
+    LowRankReport report;
+    report.dense_accuracy = accuracy(net, eval_data);
+    report.dense_seconds  = feedforward_seconds(net, eval_data);
+    report.ranks.resize(config.layers.size(), 0);
+
+    // back to front <- indices of layers in front stay valid
+    std::vector<size_t> order(config.layers.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return config.layers[a] > config.layers[b]; });
+    for(size_t idx: order) {
+        size_t left_layer_idx = config.layers[idx];
+        if(left_layer_idx >= net.weights.size() - net.post_process)
+            raise_critical("Can't factorize weights of layer {}.", left_layer_idx);
+        size_t m = net.weights[left_layer_idx].n_rows;
+        size_t n = net.weights[left_layer_idx].n_cols;
+        Svd    s = svd(net.weights[left_layer_idx]);
+
+        size_t rank = config.budget == RankBudget::Energy ? energy_rank(s.s, config.energy)
+                                                          : accuracy_rank(net, left_layer_idx, s, eval_data, config.max_accuracy_drop);
+        if(rank * (m + n) >= m * n) {
+            log_learn_general("Rank {} of {}x{} weights of layer {} doesn't save any multiplications; not factorized", rank, m, n, left_layer_idx);
+            continue;
+        }
+        insert_factorization(net, left_layer_idx, s, rank);
+        report.ranks[idx] = rank;
+        log_learn_general("Factorized {}x{} weights of layer {} with rank {}", m, n, left_layer_idx, rank);
+    }
+
+    report.factorized_accuracy = accuracy(net, eval_data);
+    report.factorized_seconds  = feedforward_seconds(net, eval_data);
+    log_learn_general("Low rank factorization: eval accuracy {} -> {}; feedforward {} s -> {} s; speedup {}",
+                      report.dense_accuracy,
+                      report.factorized_accuracy,
+                      report.dense_seconds,
+                      report.factorized_seconds,
+                      report.dense_seconds / report.factorized_seconds);
+    return report;
+}
+} // namespace NeuralNet
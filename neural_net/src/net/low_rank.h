@@ -0,0 +1,45 @@
+#pragma once
+#include "hyper/data.h"
+#include "net/net.h"
+
+namespace NeuralNet {
+// how the rank of each factorized layer gets chosen
+enum class RankBudget {
+    // keep energy of the squared singular values
+    Energy,
+    // smallest rank losing at most max_accuracy_drop of eval accuracy
+    Accuracy
+};
+
+struct LowRankConfig {
+    // left layer indices of weights to factorize; post process layer not allowed
+    std::vector<size_t> layers;
+    RankBudget          budget = RankBudget::Energy;
+    // fraction of sum of squared singular values
+    float energy = 0.9f;
+    // fraction of eval data sets, for each layer
+    float max_accuracy_drop = 0.01f;
+};
+
+// effect of factorize_low_rank on eval data
+struct LowRankReport {
+    // one per factorized layer, in order of LowRankConfig::layers; 0 -> not worth factorizing
+    std::vector<size_t> ranks;
+    // fraction of eval data sets
+    float dense_accuracy      = 0.0f;
+    float factorized_accuracy = 0.0f;
+    // feedforward of all eval data
+    double dense_seconds      = 0.0;
+    double factorized_seconds = 0.0;
+};
+
+// replace weights W (m x n) of each selected layer with a truncated svd U_r S_r V_r^T
+// as two layers: sqrt(S_r) V_r^T (r x n) into a linear bottleneck of r neurons, then U_r sqrt(S_r) (m x r)
+// r * (m + n) instead of m * n multiplications; skips layers where that isn't smaller
+// the result is a normal network <- feedforward, sgd fine-tuning and save/load work unchanged
+// logs speedup and accuracy change on eval data
+LowRankReport factorize_low_rank(Network& net, const LowRankConfig& config, const Data& eval_data);
+
+// insert the rank r factorization of weights[left_layer_idx]
+void factorize_layer(Network& net, size_t left_layer_idx, size_t rank);
+} // namespace NeuralNet
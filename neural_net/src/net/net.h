@@ -1,28 +1,39 @@
 #pragma once
 #include "hyper/data.h"
 #include "learn/evaluator.h"
+#include "main/profiler.h"
 #include "net/costs.h"
+#include "net/parameters.h"
 
 namespace NeuralNet {
-struct Network {
+class RingCommunicator;
+class TrialCache;
+
+// weights and biases are views into one flat buffer, see FlatParameters
+struct Network: public FlatParameters {
     size_t num_layers;
     // one element per layer; amount of neurons
     std::vector<size_t> sizes;
-    // column vector for each layer, except input layer; represented as single-column matrix/
-    // biases[i] are for i+1-th layer
-    std::vector<arma::fvec> biases;
-    // matrix for each space between layers
-    // weights[i] are between i-th and i+1-th layer
-    // w_(j,k) = weight from k-th in first layer to j-th in second layer
-    std::vector<arma::fmat> weights;
 
     std::function<float(const arma::fvec& y, const arma::fvec& a)> evaluator = DefaultEvaluater::classifier;
 
     std::shared_ptr<Cost> cost;
 
+    // congruent to all weights in flat; 0 -> weight has been pruned and stays 0 during training, see prune_magnitude
+    // empty -> nothing pruned
+    arma::fvec weight_mask;
+
     // true -> last layer is post process layer <- this layer won't be changed by learning algorithm
     bool post_process = false;
 
+    // one element per layer; true -> identity instead of sigmoid, bottleneck of a factorized layer, see factorize_low_rank
+    // empty -> all layers use sigmoid
+    std::vector<bool> linear_layers;
+
+    bool is_linear(size_t layer_idx) const { return layer_idx < linear_layers.size() && linear_layers[layer_idx]; }
+    // activation of layer from its weighted input z
+    arma::fmat activate(size_t layer_idx, const arma::fmat& z) const { return is_linear(layer_idx) ? z : sigmoid(z); }
+
     std::string to_str() const {
         std::stringstream out;
         out << "<Network: sizes: ";
@@ -40,9 +51,40 @@ struct Network {
     }
 };
 
+// TestAccuracy and EvalAccuracy depend on monitoring, all others only on time
 enum class LearningScheduleType : uint8_t { None = 0,
                                             TestAccuracy,
-                                            EvalAccuracy };
+                                            EvalAccuracy,
+                                            StepDecay,
+                                            Exponential,
+                                            CosineAnnealing,
+                                            OneCycle };
+
+// how a training metric gets monitored
+// Full: evaluate all training data after each epoch
+// Subsample: evaluate a fixed random subset after each epoch, report confidence interval
+// InFlight: accumulate from activations of backprop during the epoch <- no extra cost, weights change while accumulating
+enum class MonitorMode : uint8_t { Full = 0,
+                                   Subsample,
+                                   InFlight };
+
+enum class LearnStatus : uint8_t { Finished = 0,
+                                   Diverged };
+
+// metric deciding which epoch had the best weights
+enum class StopMetric : uint8_t { None = 0,
+                                  TestAccuracy,
+                                  EvalAccuracy,
+                                  TrainAccuracy,
+                                  TestCost,
+                                  EvalCost,
+                                  TrainCost };
+
+enum class OptimizerType : uint8_t { Momentum = 0,
+                                     Nesterov,
+                                     RMSProp,
+                                     Adam,
+                                     AdamW };
 
 // data in hyper-space
 struct HyperParameter {
@@ -62,6 +104,16 @@ struct HyperParameter {
     float lambda_l1 = 0.0f;
     float lambda_l2 = 0.0f;
 
+    OptimizerType optimizer_type = OptimizerType::Momentum;
+    // decay rates of first and second moment estimates
+    // RMSProp only uses beta2
+    float beta1 = 0.9f;
+    float beta2 = 0.999f;
+    // avoid division by 0 in adaptive optimizers
+    float epsilon = 1e-8f;
+    // decoupled weight decay, only used by AdamW
+    float weight_decay = 0.0f;
+
     LearningScheduleType learning_schedule_type = LearningScheduleType::None;
     // half eta after not improving in that many epochs
     // must be at least 2
@@ -71,10 +123,72 @@ struct HyperParameter {
     // ignored if learning rate schedule disabled
     float stop_eta_fraction = 0.0f;
 
+    // time based schedules, progress is measured in epochs with fractions for each mini batch
+    // StepDecay: multiply eta by decay_rate every decay_epochs
+    // Exponential: multiply eta by decay_rate each epoch
+    float  decay_rate   = 0.5f;
+    size_t decay_epochs = 10;
+    // CosineAnnealing: anneal from init_eta to min_eta in restart_epochs, then restart
+    // each cycle is restart_mult times longer than the last one
+    size_t restart_epochs = 10;
+    size_t restart_mult   = 1;
+    // OneCycle: rise linearly from init_eta / one_cycle_div to init_eta during one_cycle_peak of max_epochs,
+    // then anneal to min_eta
+    float one_cycle_div  = 25.0f;
+    float one_cycle_peak = 0.3f;
+    // lower bound of CosineAnnealing and OneCycle
+    float min_eta = 0.0f;
+    // linear increase from 0 during the first epochs; applies to all schedules
+    // 0 -> disabled
+    float warmup_epochs = 0.0f;
+
+    // fraction of correct results on eval data, or test data when eval data isn't monitored
+    // reaching it gets recorded in epochs_to_target and time_to_target
+    // 0 -> disabled
+    float target_accuracy = 0.0f;
+    // terminate learning once target accuracy has been reached
+    bool stop_at_target = false;
+
+    // keep weights of best epoch according to this metric and restore them after learning
+    // None -> keep weights of last epoch
+    StopMetric best_weights_metric = StopMetric::None;
+    // terminate learning when best_weights_metric didn't improve in that many epochs
+    // 0 -> disabled
+    size_t patience = 0;
+
+    // check for non-finite weights and gradients and for exploding cost every that many mini batches
+    // 0 -> disabled
+    size_t divergence_check_interval = 50;
+    // diverged when mean training cost since the last check exceeds divergence_factor times the one of the first check
+    // 0 -> only check for non-finite values; hyper surfers enable it for their probes
+    float divergence_factor = 0.0f;
+
+    // write checkpoints of the network and its TrainingState to this path on a background thread, see CheckpointWriter
+    // resume with load_checkpoint and sgd with the loaded state
+    // empty -> disabled
+    std::string checkpoint_path;
+    // write a checkpoint after every that many epochs or once that many seconds passed since the last one
+    // 0 -> disabled
+    size_t checkpoint_epochs  = 0;
+    float  checkpoint_seconds = 0.0f;
+
     const Data* training_data = nullptr;
     const Data* test_data     = nullptr;
     const Data* eval_data     = nullptr;
 
+    // probes of the hyper surfer check it before training, see TrialCache
+    // nullptr -> always train
+    TrialCache* trial_cache = nullptr;
+    // hyper surfer trains repetitions and probe pairs of one network in lockstep, see lockstep_sgd
+    bool lockstep_trials = false;
+
+    // data parallel training; gradients of all ranks get summed before each optimizer step, see RingCommunicator
+    // training_data is the shard of this rank and mini_batch_size the global batch size
+    // nullptr -> single process
+    RingCommunicator* communicator = nullptr;
+    // send gradients in half precision <- halves all-reduce traffic
+    bool fp16_gradients = false;
+
     // run time
     bool      monitor_test_cost      = false;
     bool      monitor_test_accuracy  = false;
@@ -82,16 +196,66 @@ struct HyperParameter {
     bool      monitor_eval_accuracy  = false;
     bool      monitor_train_cost     = false;
     bool      monitor_train_accuracy = false;
+    // evaluate monitors of each epoch on a snapshot while the next epoch trains
+    // accuracy based schedules react one epoch later
+    bool      async_monitoring       = false;
     long long learn_time             = 0;
 
+    MonitorMode train_cost_mode     = MonitorMode::Full;
+    MonitorMode train_accuracy_mode = MonitorMode::Full;
+    // amount of data sets in subset of MonitorMode::Subsample
+    size_t monitor_subsample_size = 1000;
+    // append one json line of throughput, resources and monitors per epoch; truncated by the first epoch
+    // asynchronous monitoring writes monitors in an extra line with their own epoch once they are done
+    // empty -> disabled
+    // data parallel training -> written by rank 0 only
+    std::string metrics_path;
+    // measure phases of each epoch into epoch_profiles, requires NEURAL_NET_PROFILE, see Profiler
+    bool profile = false;
+    // additionally record every scope for Profiler::save_chrome_trace
+    // data parallel training -> recorded by rank 0 only, save it from rank 0
+    bool profile_trace = false;
+
     // results
     std::vector<float> test_costs, test_accuracies, eval_costs, eval_accuracies, train_costs, train_accuracies;
+    // half widths of 95% confidence intervals; one per epoch, only in MonitorMode::Subsample
+    std::vector<float> train_cost_intervals, train_accuracy_intervals;
+    // throughput and resources; one per epoch
+    // epoch_times include monitor_times, samples_per_second and gflops only count training
+    std::vector<float>  samples_per_second, epoch_times, monitor_times, gflops;
+    std::vector<size_t> rss_bytes, peak_rss_bytes;
+    // 0 -> target accuracy not reached
+    size_t    epochs_to_target = 0;
+    long long time_to_target   = 0;
+    // epoch of restored weights, starting at 1
+    // 0 -> nothing restored
+    size_t best_epoch = 0;
+    // Diverged -> learning got aborted, results are incomplete
+    LearnStatus learn_status = LearnStatus::Finished;
+    // one per epoch when profiling
+    std::vector<EpochProfile> epoch_profiles;
 
+    // all results of earlier learning, eval results included <- repeated probes mustn't accumulate them
     void reset_results() {
         test_costs.resize(0);
         test_accuracies.resize(0);
+        eval_costs.resize(0);
+        eval_accuracies.resize(0);
         train_costs.resize(0);
         train_accuracies.resize(0);
+        train_cost_intervals.resize(0);
+        train_accuracy_intervals.resize(0);
+        samples_per_second.resize(0);
+        epoch_times.resize(0);
+        monitor_times.resize(0);
+        gflops.resize(0);
+        rss_bytes.resize(0);
+        peak_rss_bytes.resize(0);
+        epochs_to_target = 0;
+        time_to_target   = 0;
+        best_epoch       = 0;
+        learn_status     = LearnStatus::Finished;
+        epoch_profiles.resize(0);
     }
 
     void reset_monitor() {
@@ -103,6 +267,12 @@ struct HyperParameter {
         monitor_train_accuracy = false;
     }
 
+    // learning rate gets reduced when monitored accuracy stops improving
+    bool accuracy_schedule() const {
+        return learning_schedule_type == LearningScheduleType::TestAccuracy ||
+               learning_schedule_type == LearningScheduleType::EvalAccuracy;
+    }
+
     // check if required parameters are given
     void is_valid() const {
         if((monitor_test_cost || monitor_test_accuracy) && test_data == nullptr)
@@ -123,16 +293,84 @@ struct HyperParameter {
             if(!monitor_eval_accuracy)
                 raise_critical("The evaluation data accuracy has to be monitored for early stopping and learning rate schedule.");
             break;
+        case LearningScheduleType::StepDecay:
+            if(!decay_epochs)
+                raise_critical("decay_epochs has to be defined for step decay.");
+            [[fallthrough]];
+        case LearningScheduleType::Exponential:
+            if(decay_rate <= 0.0f || decay_rate > 1.0f)
+                raise_critical("decay_rate has to be in (0; 1].");
+            break;
+        case LearningScheduleType::CosineAnnealing:
+            if(!restart_epochs || !restart_mult)
+                raise_critical("restart_epochs and restart_mult have to be at least one.");
+            break;
+        case LearningScheduleType::OneCycle:
+            if(one_cycle_div < 1.0f)
+                raise_critical("one_cycle_div has to be at least one.");
+            if(one_cycle_peak <= 0.0f || one_cycle_peak >= 1.0f)
+                raise_critical("one_cycle_peak has to be in (0; 1).");
+            break;
         case LearningScheduleType::None:
             break;
         }
-        if(learning_schedule_type != LearningScheduleType::None) {
+        if(warmup_epochs < 0.0f)
+            raise_critical("warmup_epochs can't be negative.");
+        if(accuracy_schedule()) {
             if(no_improvement_in < 2)
                 raise_critical("no_improvement_in has to be at least two.");
             if(!stop_eta_fraction)
                 raise_critical("stop_eta_fraction has to be defined.");
         }
 
+        if(target_accuracy) {
+            if(!monitor_eval_accuracy && !monitor_test_accuracy)
+                raise_critical("The evaluation or test data accuracy has to be monitored for a target accuracy.");
+            if(target_accuracy < 0.0f || target_accuracy > 1.0f)
+                raise_critical("target_accuracy has to be a fraction.");
+        }
+        switch(best_weights_metric) {
+        case StopMetric::TestAccuracy:
+            if(!monitor_test_accuracy)
+                raise_critical("The test data accuracy has to be monitored to keep the best weights.");
+            break;
+        case StopMetric::EvalAccuracy:
+            if(!monitor_eval_accuracy)
+                raise_critical("The evaluation data accuracy has to be monitored to keep the best weights.");
+            break;
+        case StopMetric::TrainAccuracy:
+            if(!monitor_train_accuracy)
+                raise_critical("The training data accuracy has to be monitored to keep the best weights.");
+            break;
+        case StopMetric::TestCost:
+            if(!monitor_test_cost)
+                raise_critical("The test data cost has to be monitored to keep the best weights.");
+            break;
+        case StopMetric::EvalCost:
+            if(!monitor_eval_cost)
+                raise_critical("The evaluation data cost has to be monitored to keep the best weights.");
+            break;
+        case StopMetric::TrainCost:
+            if(!monitor_train_cost)
+                raise_critical("The training data cost has to be monitored to keep the best weights.");
+            break;
+        case StopMetric::None:
+            if(patience)
+                raise_critical("best_weights_metric has to be defined for patience.");
+            break;
+        }
+        if((train_cost_mode == MonitorMode::Subsample || train_accuracy_mode == MonitorMode::Subsample) &&
+           !monitor_subsample_size)
+            raise_critical("monitor_subsample_size has to be defined for subsample monitoring.");
+        if(!checkpoint_path.empty()) {
+            if(!checkpoint_epochs && !checkpoint_seconds)
+                raise_critical("checkpoint_epochs or checkpoint_seconds has to be defined for checkpoints.");
+            if(async_monitoring)
+                raise_critical("Checkpoints can't be written with asynchronous monitoring.");
+        }
+        if(beta1 < 0.0f || beta1 >= 1.0f || beta2 < 0.0f || beta2 >= 1.0f)
+            raise_critical("beta1 and beta2 have to be in [0; 1).");
+
         if(!mini_batch_size)
             raise_critical("mini_batch_size needs to be defined");
         if(!init_eta)
@@ -170,13 +408,70 @@ struct HyperParameter {
             if(stop_eta_fraction)
                 out << "\tStopping early when eta drops below: 1/" << stop_eta_fraction << std::endl;
             break;
+        case LearningScheduleType::StepDecay:
+            out << "\tusing step decay with starting eta: " << init_eta << std::endl;
+            out << "\tmultiply eta by " << decay_rate << " every " << decay_epochs << " epochs" << std::endl;
+            break;
+        case LearningScheduleType::Exponential:
+            out << "\tusing exponential decay with starting eta: " << init_eta << std::endl;
+            out << "\tmultiply eta by " << decay_rate << " each epoch" << std::endl;
+            break;
+        case LearningScheduleType::CosineAnnealing:
+            out << "\tusing cosine annealing from eta: " << init_eta << " to " << min_eta << std::endl;
+            out << "\twarm restart after " << restart_epochs << " epochs, cycles growing by factor " << restart_mult
+                << std::endl;
+            break;
+        case LearningScheduleType::OneCycle:
+            out << "\tusing one cycle from eta: " << init_eta / one_cycle_div << " to " << init_eta << " to " << min_eta
+                << std::endl;
+            out << "\tpeak after " << one_cycle_peak * (max_epochs + 1) << " epochs" << std::endl;
+            break;
         case LearningScheduleType::None:
             out << "\tusing constant eta: " << init_eta << std::endl;
             break;
         }
+        if(warmup_epochs)
+            out << "\tlinear warmup during first " << warmup_epochs << " epochs" << std::endl;
         out << "\tstop at max epochs: " << max_epochs << std::endl;
 
-        out << "\tmu: " << mu << std::endl;
+        switch(optimizer_type) {
+        case OptimizerType::Momentum:
+            out << "\tusing momentum with mu: " << mu << std::endl;
+            break;
+        case OptimizerType::Nesterov:
+            out << "\tusing nesterov momentum with mu: " << mu << std::endl;
+            break;
+        case OptimizerType::RMSProp:
+            out << "\tusing RMSProp with decay rate: " << beta2 << std::endl;
+            break;
+        case OptimizerType::Adam:
+            out << "\tusing Adam with beta1: " << beta1 << " beta2: " << beta2 << std::endl;
+            break;
+        case OptimizerType::AdamW:
+            out << "\tusing AdamW with beta1: " << beta1 << " beta2: " << beta2 << " weight decay: " << weight_decay
+                << std::endl;
+            break;
+        }
+        if(target_accuracy)
+            out << "\ttarget accuracy: " << target_accuracy << std::endl;
+        if(best_weights_metric != StopMetric::None) {
+            out << "\trestoring best weights" << std::endl;
+            if(patience)
+                out << "\tstopping after no improvement in " << patience << " epochs" << std::endl;
+        }
+        if(async_monitoring)
+            out << "\tmonitoring asynchronously with a lag of one epoch" << std::endl;
+        if(!checkpoint_path.empty())
+            out << "\twriting checkpoints to: " << checkpoint_path << std::endl;
+        if(!metrics_path.empty())
+            out << "\twriting metrics of each epoch to: " << metrics_path << std::endl;
+        if(profile)
+            out << "\tprofiling phases of each epoch" << (profile_trace ? " with trace" : "") << std::endl;
+        if(monitor_train_cost && train_cost_mode != MonitorMode::Full)
+            out << "\ttraining cost " << (train_cost_mode == MonitorMode::InFlight ? "in flight" : "on subsample") << std::endl;
+        if(monitor_train_accuracy && train_accuracy_mode != MonitorMode::Full)
+            out << "\ttraining accuracy " << (train_accuracy_mode == MonitorMode::InFlight ? "in flight" : "on subsample")
+                << std::endl;
 
         if(lambda_l1)
             out << "\tusing L1 regularization with lambda: " << lambda_l1 << std::endl;
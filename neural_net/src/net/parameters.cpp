@@ -0,0 +1,58 @@
+#include "parameters.h"
+
+#include "pch.h"
+
+namespace NeuralNet {
+void FlatParameters::allocate(const std::vector<size_t>& sizes) {
+    size_t n_params = 0;
+    for(size_t left_layer_idx = 0; left_layer_idx + 1 < sizes.size(); ++left_layer_idx)
+        n_params += sizes[left_layer_idx + 1] * sizes[left_layer_idx] + sizes[left_layer_idx + 1];
+    flat.zeros(n_params);
+
+    // views can't be moved around <- would turn them into copies
+    weights.clear();
+    weights.reserve(sizes.size());
+    biases.clear();
+    biases.reserve(sizes.size());
+    float* ptr = flat.memptr();
+    // one for each space between layers
+    for(size_t left_layer_idx = 0; left_layer_idx + 1 < sizes.size(); ++left_layer_idx) {
+        // from next layer to current layer
+        weights.emplace_back(ptr, sizes[left_layer_idx + 1], sizes[left_layer_idx], false, true);
+        ptr += sizes[left_layer_idx + 1] * sizes[left_layer_idx];
+    }
+    // one for each layer except input layer
+    for(size_t layer_idx = 1; layer_idx < sizes.size(); ++layer_idx) {
+        biases.emplace_back(ptr, sizes[layer_idx], false, true);
+        ptr += sizes[layer_idx];
+    }
+}
+
+size_t FlatParameters::weight_offset(size_t left_layer_idx) const {
+    if(left_layer_idx == weights.size())
+        return weights.empty() ? 0 : weight_offset(left_layer_idx - 1) + weights[left_layer_idx - 1].n_elem;
+    return weights[left_layer_idx].memptr() - flat.memptr();
+}
+
+size_t FlatParameters::bias_offset(size_t left_layer_idx) const {
+    if(left_layer_idx == biases.size())
+        return biases.empty() ? 0 : bias_offset(left_layer_idx - 1) + biases[left_layer_idx - 1].n_elem;
+    return biases[left_layer_idx].memptr() - flat.memptr();
+}
+
+void FlatParameters::bind_like(const FlatParameters& other) {
+    weights.clear();
+    weights.reserve(other.weights.size());
+    biases.clear();
+    biases.reserve(other.biases.size());
+    float* ptr = flat.memptr();
+    for(const arma::fmat& w: other.weights) {
+        weights.emplace_back(ptr, w.n_rows, w.n_cols, false, true);
+        ptr += w.n_elem;
+    }
+    for(const arma::fvec& b: other.biases) {
+        biases.emplace_back(ptr, b.n_rows, false, true);
+        ptr += b.n_elem;
+    }
+}
+} // namespace NeuralNet
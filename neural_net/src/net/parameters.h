@@ -0,0 +1,48 @@
+#pragma once
+#include <armadillo>
+#include <vector>
+
+namespace NeuralNet {
+// all weights followed by all biases in a single contiguous buffer
+// weights and biases are non-owning views into flat
+// -> optimizer steps, reductions and serialization work on flat directly
+struct FlatParameters {
+    arma::fvec flat;
+    // matrix for each space between layers
+    // weights[i] are between i-th and i+1-th layer
+    // w_(j,k) = weight from k-th in first layer to j-th in second layer
+    std::vector<arma::fmat> weights;
+    // column vector for each layer, except input layer
+    // biases[i] are for i+1-th layer
+    std::vector<arma::fvec> biases;
+
+    FlatParameters() = default;
+    // all 0
+    explicit FlatParameters(const std::vector<size_t>& sizes) { allocate(sizes); }
+    // views have to point into the new buffer
+    FlatParameters(const FlatParameters& other)
+        : flat(other.flat) { bind_like(other); }
+    FlatParameters& operator=(const FlatParameters& other) {
+        if(this != &other) {
+            flat = other.flat;
+            bind_like(other);
+        }
+        return *this;
+    }
+
+    // sizes of layers, first is input, last is output
+    // set all to 0
+    void allocate(const std::vector<size_t>& sizes);
+
+    // amount of floats used by all weights; biases start here
+    size_t n_weights() const { return weights.empty() ? 0 : weight_offset(weights.size()); }
+    // offset of weights[left_layer_idx] in flat; left_layer_idx may be one past the end
+    size_t weight_offset(size_t left_layer_idx) const;
+    // offset of biases[left_layer_idx] in flat; left_layer_idx may be one past the end
+    size_t bias_offset(size_t left_layer_idx) const;
+
+private:
+    // create views with same shapes as in other
+    void bind_like(const FlatParameters& other);
+};
+} // namespace NeuralNet
@@ -0,0 +1,149 @@
+#include "pruning.h"
+
+#include "learn/eval.h"
+#include "pch.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace NeuralNet {
+// layers changed by learning
+static size_t trainable_layers(const Network& net) {
+    return net.weights.size() - net.post_process;
+}
+
+void prune_magnitude(Network& net, float sparsity) {
+    if(sparsity < 0.0f || sparsity >= 1.0f)
+        raise_critical("Sparsity has to be in [0; 1).");
+    if(!net.weight_mask.n_elem)
+        net.weight_mask = arma::fvec(net.n_weights(), arma::fill::ones);
+
+    for(size_t layer_idx = 0; layer_idx < trainable_layers(net); ++layer_idx) {
+        float* weight   = net.weights[layer_idx].memptr();
+        float* mask     = net.weight_mask.memptr() + net.weight_offset(layer_idx);
+        size_t n_elem   = net.weights[layer_idx].n_elem;
+        size_t n_pruned = static_cast<size_t>(sparsity * n_elem);
+        if(!n_pruned)
+            continue;
+
+        std::vector<float> magnitudes(n_elem);
+        for(size_t i = 0; i < n_elem; ++i)
+            magnitudes[i] = std::abs(weight[i]);
+        std::nth_element(magnitudes.begin(), magnitudes.begin() + n_pruned - 1, magnitudes.end());
+        float threshold = magnitudes[n_pruned - 1];
+
+        size_t pruned = 0;
+        for(size_t i = 0; i < n_elem; ++i)
+            if(std::abs(weight[i]) < threshold) {
+                weight[i] = 0.0f;
+                mask[i]   = 0.0f;
+                ++pruned;
+            }
+        // ties with threshold until sparsity is reached
+        for(size_t i = 0; i < n_elem && pruned < n_pruned; ++i)
+            if(std::abs(weight[i]) == threshold) {
+                weight[i] = 0.0f;
+                mask[i]   = 0.0f;
+                ++pruned;
+            }
+    }
+    log_learn_general("Magnitude pruning to sparsity {}; weight sparsity now {}", sparsity, weight_sparsity(net));
+}
+
+void prune_neurons(Network& net, float fraction, const Data* data) {
+    if(fraction < 0.0f || fraction >= 1.0f)
+        raise_critical("Fraction of pruned neurons has to be in [0; 1).");
+
+    // mean activation of each layer except input
+    std::vector<arma::fvec> mean_activations;
+    if(data) {
+        arma::fmat a = data->get_x();
+        for(size_t left_layer_idx = 0; left_layer_idx < net.num_layers - 1; ++left_layer_idx) {
+            a = net.activate(left_layer_idx + 1, net.weights[left_layer_idx] * a + net.biases[left_layer_idx] * arma::fmat(1, a.n_cols, arma::fill::ones));
+            mean_activations.emplace_back(arma::sum(a, 1) / static_cast<float>(a.n_cols));
+        }
+    }
+
+    // neurons kept in each layer; input, output and in front of post process layer stay complete
+    std::vector<std::vector<arma::uword>> kept(net.num_layers);
+    for(size_t layer_idx = 0; layer_idx < net.num_layers; ++layer_idx) {
+        kept[layer_idx].resize(net.sizes[layer_idx]);
+        std::iota(kept[layer_idx].begin(), kept[layer_idx].end(), 0);
+    }
+    for(size_t layer_idx = 1; layer_idx + 1 + net.post_process < net.num_layers; ++layer_idx) {
+        const arma::fmat& incoming = net.weights[layer_idx - 1];
+        arma::fmat&       outgoing = net.weights[layer_idx];
+        size_t            size     = net.sizes[layer_idx];
+        size_t            n_pruned = std::min(static_cast<size_t>(fraction * size), size - 1);
+        if(!n_pruned)
+            continue;
+
+        // squared norm of all weights connected to neuron
+        std::vector<float> scores(size, 0.0f);
+        for(size_t neuron = 0; neuron < size; ++neuron) {
+            for(size_t col = 0; col < incoming.n_cols; ++col)
+                scores[neuron] += incoming(neuron, col) * incoming(neuron, col);
+            const float* out = outgoing.colptr(neuron);
+            for(size_t row = 0; row < outgoing.n_rows; ++row)
+                scores[neuron] += out[row] * out[row];
+        }
+        std::vector<arma::uword>& neurons = kept[layer_idx];
+        std::sort(neurons.begin(), neurons.end(), [&](arma::uword a, arma::uword b) { return scores[a] < scores[b]; });
+        // next layer gets mean input of removed neurons as bias
+        if(data)
+            for(size_t idx = 0; idx < n_pruned; ++idx) {
+                arma::uword  neuron = neurons[idx];
+                float        mean   = mean_activations[layer_idx - 1](neuron);
+                const float* out    = outgoing.colptr(neuron);
+                for(size_t row = 0; row < outgoing.n_rows; ++row)
+                    net.biases[layer_idx](row) += out[row] * mean;
+            }
+        neurons.erase(neurons.begin(), neurons.begin() + n_pruned);
+        std::sort(neurons.begin(), neurons.end());
+    }
+
+    std::vector<size_t> sizes(net.num_layers);
+    for(size_t layer_idx = 0; layer_idx < net.num_layers; ++layer_idx)
+        sizes[layer_idx] = kept[layer_idx].size();
+    FlatParameters pruned(sizes);
+    arma::fvec     pruned_mask(net.weight_mask.n_elem ? pruned.n_weights() : 0);
+    for(size_t left_layer_idx = 0; left_layer_idx < net.num_layers - 1; ++left_layer_idx) {
+        const std::vector<arma::uword>& rows = kept[left_layer_idx + 1];
+        const std::vector<arma::uword>& cols = kept[left_layer_idx];
+        for(size_t col = 0; col < cols.size(); ++col)
+            for(size_t row = 0; row < rows.size(); ++row) {
+                pruned.weights[left_layer_idx](row, col) = net.weights[left_layer_idx](rows[row], cols[col]);
+                if(pruned_mask.n_elem)
+                    pruned_mask(pruned.weight_offset(left_layer_idx) + col * rows.size() + row) =
+                        net.weight_mask(net.weight_offset(left_layer_idx) + cols[col] * net.sizes[left_layer_idx + 1] + rows[row]);
+            }
+        for(size_t row = 0; row < rows.size(); ++row)
+            pruned.biases[left_layer_idx](row) = net.biases[left_layer_idx](rows[row]);
+    }
+
+    // views get bound to the new buffer
+    static_cast<FlatParameters&>(net) = pruned;
+    net.sizes       = sizes;
+    net.weight_mask = pruned_mask;
+    std::string sizes_str;
+    for(size_t size: sizes)
+        sizes_str += std::to_string(size) + " ";
+    log_learn_general("Pruned fraction {} of hidden neurons; sizes now: {}", fraction, sizes_str);
+}
+
+void apply_weight_mask(Network& net) {
+    if(net.weight_mask.n_elem)
+        net.flat.head(net.weight_mask.n_elem) %= net.weight_mask;
+}
+
+float weight_sparsity(const Network& net) {
+    size_t zeros = 0;
+    size_t total = 0;
+    for(size_t layer_idx = 0; layer_idx < trainable_layers(net); ++layer_idx) {
+        const arma::fmat& weight = net.weights[layer_idx];
+        zeros += std::count(weight.begin(), weight.end(), 0.0f);
+        total += weight.n_elem;
+    }
+    return total ? static_cast<float>(zeros) / total : 0.0f;
+}
+} // namespace NeuralNet
@@ -0,0 +1,22 @@
+#pragma once
+#include "hyper/data.h"
+#include "net/net.h"
+
+namespace NeuralNet {
+// set the smallest weights of each layer to 0 until sparsity of them are 0
+// doesn't effect post process layer
+// sets weight_mask <- pruned weights stay 0 when fine-tuning with sgd
+void prune_magnitude(Network& net, float sparsity);
+
+// remove fraction of the neurons of each hidden layer with the smallest incoming and outgoing weights
+// shrinks sizes, weights and biases; keeps at least one neuron per layer
+// data given -> fold mean activation of removed neurons into biases of next layer
+// weight_mask gets shrunk as well
+void prune_neurons(Network& net, float fraction, const Data* data = nullptr);
+
+// zero all weights outside of weight_mask
+void apply_weight_mask(Network& net);
+
+// fraction of weights that are 0; without post process layer
+float weight_sparsity(const Network& net);
+} // namespace NeuralNet
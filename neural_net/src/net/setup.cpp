@@ -2,7 +2,13 @@
 
 #include "pch.h"
 
+#include <algorithm>
+#include <cstring>
+
 namespace NeuralNet {
+static constexpr char     s_binary_magic[4] = {'N', 'N', 'B', 'N'};
+static constexpr uint32_t s_binary_version  = 1;
+
 void create_network(Network& net, const std::vector<size_t>& sizes, bool post_process) {
     // todo: make multi threaded
     arma::arma_rng::set_seed_random();
@@ -26,24 +32,45 @@ void load_json_network(Network& net, const std::string& json_path) {
 
     net.sizes      = json_net["sizes"].get<std::vector<size_t>>();
     net.num_layers = net.sizes.size();
+    null_weight_init(net);
+
+    std::vector<std::vector<std::vector<float>>> json_weights =
+        json_net["weights"].get<std::vector<std::vector<std::vector<float>>>>();
+    std::vector<std::vector<float>> json_biases = json_net["biases"].get<std::vector<std::vector<float>>>();
+    if(json_weights.size() != net.weights.size() || json_biases.size() != net.biases.size())
+        raise_critical("Json network '{}' doesn't have weights and biases for all layers.", json_path);
 
     // loop over layer-by-layer weight sets
-    for(const std::vector<std::vector<float>>& w:
-        json_net["weights"].get<std::vector<std::vector<std::vector<float>>>>()) {
-        // create matrix of weights for this layer-by-layer part
-        arma::fmat weight(w[0].size(), w.size());
+    for(size_t layer_idx = 0; layer_idx < json_weights.size(); ++layer_idx) {
+        const std::vector<std::vector<float>>& w      = json_weights[layer_idx];
+        arma::fmat&                            weight = net.weights[layer_idx];
+        // every column <- ragged or empty weights would be read out of bounds
+        bool wrong_shape = w.empty() || w.size() != weight.n_cols;
+        for(size_t x = 0; !wrong_shape && x < w.size(); ++x)
+            wrong_shape = w[x].size() != weight.n_rows;
+        if(wrong_shape)
+            raise_critical("Weights of layer {} in json network '{}' have the wrong shape.", layer_idx, json_path);
         // loop over columns
         for(unsigned int x = 0; x < w.size(); ++x)
             // loop over rows
-            for(unsigned int y = 0; y < w[0].size(); ++y)
+            for(unsigned int y = 0; y < w[x].size(); ++y)
                 weight(y, x) = w[x][y];
-        net.weights.push_back(weight);
     }
 
-    for(const std::vector<float>& b: json_net["biases"].get<std::vector<std::vector<float>>>())
-        net.biases.push_back(b);
+    for(size_t layer_idx = 0; layer_idx < json_biases.size(); ++layer_idx) {
+        const std::vector<float>& b = json_biases[layer_idx];
+        if(b.size() != net.biases[layer_idx].n_elem)
+            raise_critical("Biases of layer {} in json network '{}' have the wrong shape.", layer_idx, json_path);
+        std::copy(b.begin(), b.end(), net.biases[layer_idx].begin());
+    }
 
     net.cost = Cost::get(json_net["cost"]);
+    // only in factorized networks
+    if(json_net.contains("linear_layers")) {
+        net.linear_layers = json_net["linear_layers"].get<std::vector<bool>>();
+        if(net.linear_layers.size() != net.num_layers)
+            raise_critical("Json network '{}' doesn't have a linear flag for each layer.", json_path);
+    }
 }
 
 void save_json(const Network& net, const std::string& path) {
@@ -64,6 +91,8 @@ void save_json(const Network& net, const std::string& path) {
                      {"weights", serialized_weights},
                      {"biases", serialized_biases},
                      {"cost", net.cost->to_str()}};
+    if(!net.linear_layers.empty())
+        json_net["linear_layers"] = net.linear_layers;
 
     std::ofstream file(path);
     if(!file)
@@ -72,22 +101,100 @@ void save_json(const Network& net, const std::string& path) {
     file.close();
 }
 
-void null_weight_init(Network& net) {
-    net.biases.resize(0);
-    // one for each layer except input layer
-    net.biases.reserve(net.num_layers - 1);
-    for(size_t layer_idx = 1; layer_idx < net.num_layers; ++layer_idx) {
-        net.biases.emplace_back(net.sizes[layer_idx], 1, arma::fill::zeros);
+void load_binary_network(Network& net, const std::string& path) {
+    std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
+    if(!file)
+        raise_critical("Can't open input binary network file '{}'!", path);
+    // bytes left <- lengths read from the file get checked before allocating
+    uint64_t remaining = file.tellg();
+    file.seekg(0);
+    auto read = [&](void* data, uint64_t size) {
+        if(size > remaining || !file.read(static_cast<char*>(data), size))
+            raise_critical("Binary network file '{}' is corrupt.", path);
+        remaining -= size;
+    };
+
+    // files without header are from before versioning <- no linear flags
+    char magic[sizeof(s_binary_magic)] = {};
+    bool versioned = remaining >= sizeof(magic) && file.read(magic, sizeof(magic)) && !std::memcmp(magic, s_binary_magic, sizeof(magic));
+    if(versioned) {
+        remaining -= sizeof(magic);
+        uint32_t version = 0;
+        read(&version, sizeof(version));
+        if(version != s_binary_version)
+            raise_critical("Binary network file '{}' has unsupported version {}.", path, version);
+    } else {
+        file.clear();
+        file.seekg(0);
     }
 
-    net.weights.resize(0);
-    // one for each layer except input layer
-    // one for each space between layers
-    net.weights.reserve(net.num_layers - 1);
-    for(size_t left_layer_idx = 0; left_layer_idx < net.num_layers - 1; ++left_layer_idx) {
-        // from next layer to current layer
-        net.weights.emplace_back(net.sizes[left_layer_idx + 1], net.sizes[left_layer_idx], arma::fill::zeros);
+    uint64_t num_layers = 0;
+    read(&num_layers, sizeof(num_layers));
+    if(num_layers < 2 || num_layers > remaining / sizeof(uint64_t))
+        raise_critical("Binary network file '{}' is corrupt.", path);
+    std::vector<uint64_t> sizes(num_layers);
+    read(sizes.data(), num_layers * sizeof(uint64_t));
+    uint64_t cost_length = 0;
+    read(&cost_length, sizeof(cost_length));
+    if(cost_length > remaining)
+        raise_critical("Binary network file '{}' is corrupt.", path);
+    std::string cost(cost_length, ' ');
+    read(&cost[0], cost_length);
+
+    // weights and biases have to fit into the rest of the file
+    double n_params = 0.0;
+    for(size_t layer_idx = 0; layer_idx + 1 < num_layers; ++layer_idx)
+        n_params += (sizes[layer_idx] + 1.0) * sizes[layer_idx + 1];
+    if(std::find(sizes.begin(), sizes.end(), 0) != sizes.end() || n_params * sizeof(float) > remaining)
+        raise_critical("Binary network file '{}' is corrupt.", path);
+
+    net.sizes      = std::vector<size_t>(sizes.begin(), sizes.end());
+    net.num_layers = net.sizes.size();
+    null_weight_init(net);
+    // all weights and biases at once
+    read(net.flat.memptr(), net.flat.n_elem * sizeof(float));
+    // one byte per layer, exactly num_layers
+    if(versioned) {
+        std::vector<char> linear_layers(num_layers);
+        read(linear_layers.data(), num_layers);
+        net.linear_layers = std::vector<bool>(linear_layers.begin(), linear_layers.end());
     }
+    file.close();
+
+    net.cost = Cost::get(cost);
+}
+
+void save_binary(const Network& net, const std::string& path) {
+    std::ofstream file(path, std::ios::out | std::ios::binary);
+    if(!file)
+        raise_critical("Can't open output binary network file '{}'!", path);
+
+    uint64_t              num_layers = net.sizes.size();
+    std::vector<uint64_t> sizes(net.sizes.begin(), net.sizes.end());
+    std::string           cost        = net.cost->to_str();
+    uint64_t              cost_length = cost.size();
+    file.write(s_binary_magic, sizeof(s_binary_magic));
+    file.write(reinterpret_cast<const char*>(&s_binary_version), sizeof(s_binary_version));
+    file.write(reinterpret_cast<const char*>(&num_layers), sizeof(num_layers));
+    file.write(reinterpret_cast<const char*>(sizes.data()), num_layers * sizeof(uint64_t));
+    file.write(reinterpret_cast<const char*>(&cost_length), sizeof(cost_length));
+    file.write(cost.data(), cost_length);
+    // all weights and biases at once
+    file.write(reinterpret_cast<const char*>(net.flat.memptr()), net.flat.n_elem * sizeof(float));
+    std::vector<char> linear_layers(num_layers);
+    for(size_t layer_idx = 0; layer_idx < num_layers; ++layer_idx)
+        linear_layers[layer_idx] = net.is_linear(layer_idx);
+    file.write(linear_layers.data(), num_layers);
+    file.close();
+}
+
+void null_weight_init(Network& net) {
+    // one weight matrix for each space between layers
+    // one bias vector for each layer except input layer
+    net.allocate(net.sizes);
+    // nothing pruned or factorized
+    net.weight_mask.reset();
+    net.linear_layers.clear();
 }
 
 void default_weight_reset(Network& net) {
@@ -13,6 +13,13 @@ void load_json_network(Network& net, const std::string& json_path);
 
 void save_json(const Network& net, const std::string& path);
 
+// magic and version, sizes, cost, all weights and biases as one raw block, one linear flag per layer
+// files without magic from before versioning still load
+// machine dependent <- use json for exchange
+void load_binary_network(Network& net, const std::string& path);
+
+void save_binary(const Network& net, const std::string& path);
+
 // set vectors to correct size
 void null_weight_init(Network& net);
 
@@ -0,0 +1,78 @@
+#include "sparse_net.h"
+
+#include "net/sigmoid.h"
+#include "pch.h"
+
+#include <chrono>
+
+namespace NeuralNet {
+SparseNetwork to_sparse(const Network& net, float min_sparsity) {
+    SparseNetwork sparse_net;
+    sparse_net.sizes = net.sizes;
+    sparse_net.layers.resize(net.num_layers - 1);
+    size_t n_sparse = 0;
+    for(size_t left_layer_idx = 0; left_layer_idx < net.num_layers - 1; ++left_layer_idx) {
+        const arma::fmat& weights = net.weights[left_layer_idx];
+        SparseLayer&      layer   = sparse_net.layers[left_layer_idx];
+        float             zeros   = static_cast<float>(std::count(weights.begin(), weights.end(), 0.0f));
+        layer.sparse              = zeros >= min_sparsity * weights.n_elem;
+        if(layer.sparse) {
+            layer.sparse_weights = arma::sp_fmat(weights);
+            ++n_sparse;
+        } else
+            layer.weights = weights;
+        layer.biases = net.biases[left_layer_idx];
+        layer.linear = net.is_linear(left_layer_idx + 1);
+    }
+    log_learn_extra("{} of {} layers are sparse", n_sparse, sparse_net.layers.size());
+    return sparse_net;
+}
+
+arma::fmat feedforward(const SparseNetwork& net, const arma::fmat& a) {
+    arma::fmat activations = a;
+    for(const SparseLayer& layer: net.layers) {
+        //                              <- actually of right layer
+        arma::fmat biases_mat = layer.biases * arma::fmat(1, activations.n_cols, arma::fill::ones);
+        arma::fmat z          = layer.sparse ? arma::fmat(layer.sparse_weights * activations + biases_mat)
+                                             : arma::fmat(layer.weights * activations + biases_mat);
+        activations           = layer.linear ? z : sigmoid(z);
+    }
+    return activations;
+}
+
+// best of a few runs in seconds
+template<typename Fn>
+static double best_seconds(Fn fn) {
+    double best = std::numeric_limits<double>::max();
+    for(int run = 0; run < 5; ++run) {
+        auto begin = std::chrono::steady_clock::now();
+        fn();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+    }
+    return best;
+}
+
+float measure_sparse_threshold(size_t rows, size_t cols, size_t batch_size) {
+    arma::fmat x(cols, batch_size, arma::fill::randu);
+    arma::fmat dense(rows, cols, arma::fill::randn);
+    // keep products from being optimized away
+    volatile float sink          = 0.0f;
+    double         dense_seconds = best_seconds([&]() { sink = arma::fmat(dense * x)(0); });
+
+    std::mt19937                          rng(0);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    for(float sparsity: {0.5f, 0.6f, 0.7f, 0.8f, 0.9f, 0.95f, 0.98f, 0.99f}) {
+        arma::fmat pruned = dense;
+        for(float& weight: pruned)
+            if(uniform(rng) < sparsity)
+                weight = 0.0f;
+        arma::sp_fmat sparse(pruned);
+        double        sparse_seconds = best_seconds([&]() { sink = arma::fmat(sparse * x)(0); });
+        log_learn_extra("{}x{} layer with batch size {} at sparsity {}: dense {} s; sparse {} s",
+                        rows, cols, batch_size, sparsity, dense_seconds, sparse_seconds);
+        if(sparse_seconds < dense_seconds)
+            return sparsity;
+    }
+    return 1.0f;
+}
+} // namespace NeuralNet
@@ -0,0 +1,31 @@
+#pragma once
+#include "net/net.h"
+
+namespace NeuralNet {
+// one layer of a SparseNetwork
+// sparse enough -> sparse_weights, otherwise weights
+struct SparseLayer {
+    bool          sparse = false;
+    bool          linear = false;
+    arma::sp_fmat sparse_weights;
+    arma::fmat    weights;
+    arma::fvec    biases;
+};
+
+// read-only copy of a pruned network for inference
+struct SparseNetwork {
+    std::vector<size_t>      sizes;
+    std::vector<SparseLayer> layers;
+};
+
+// layers with at least min_sparsity of their weights being 0 become sparse
+// see measure_sparse_threshold
+SparseNetwork to_sparse(const Network& net, float min_sparsity);
+
+// return output of network with input a, one column per data set
+arma::fmat feedforward(const SparseNetwork& net, const arma::fmat& a);
+
+// lowest sparsity at which sparse feedforward of a rows x cols layer beats dense for batch_size data sets
+// measured with random weights; 1 -> sparse never wins
+float measure_sparse_threshold(size_t rows, size_t cols, size_t batch_size);
+} // namespace NeuralNet
@@ -4,6 +4,7 @@
 using json = nlohmann::json;
 
 #include "main/log.h"
+#include "main/profiler.h"
 #include "main/utils.h"
 
 #include <cmath>
@@ -11,6 +12,7 @@ using json = nlohmann::json;
 #include <iomanip>
 #include <memory>
 #include <ostream>
+#include <spdlog/async.h>
 #include <spdlog/sinks/basic_file_sink.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
@@ -0,0 +1,133 @@
+#include "bench.h"
+
+#include "neural_net.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <numeric>
+#include <unordered_map>
+
+using json = nlohmann::json;
+
+static volatile float s_sink = 0.0f;
+
+void do_not_optimize(float value) {
+    s_sink = value;
+}
+
+// time calls of func in nanoseconds
+static double time_ns(const std::function<void()>& func, size_t calls) {
+    auto begin = std::chrono::high_resolution_clock::now();
+    for(size_t call = 0; call < calls; ++call)
+        func();
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::nano>(end - begin).count();
+}
+
+// linear interpolation between closest ranks
+// sorted has to be sorted and not empty
+static double percentile(const std::vector<double>& sorted, double fraction) {
+    double position = fraction * (sorted.size() - 1);
+    size_t lower    = static_cast<size_t>(position);
+    size_t upper    = std::min(lower + 1, sorted.size() - 1);
+    return sorted[lower] + (position - lower) * (sorted[upper] - sorted[lower]);
+}
+
+void BenchSuite::run(const std::string& name, const std::function<void()>& func) {
+    if(name.find(m_config.filter) == std::string::npos)
+        return;
+
+    // find amount of calls filling one repetition
+    double single_ns = std::max(1.0, time_ns(func, 1));
+    size_t calls     = std::max<size_t>(1, static_cast<size_t>(m_config.min_repetition_seconds * 1e9 / single_ns));
+    for(size_t repetition = 0; repetition < m_config.warmup_repetitions; ++repetition)
+        time_ns(func, calls);
+
+    std::vector<double> samples(m_config.repetitions);
+    for(double& sample: samples)
+        sample = time_ns(func, calls) / calls;
+    std::sort(samples.begin(), samples.end());
+
+    BenchResult result;
+    result.name                 = name;
+    result.repetitions          = samples.size();
+    result.calls_per_repetition = calls;
+    result.median               = percentile(samples, 0.5);
+    result.p10                  = percentile(samples, 0.1);
+    result.p90                  = percentile(samples, 0.9);
+    result.min                  = samples.front();
+    result.mean                 = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    log_client_general("{:<50} median: {:>12.0f} ns; p10: {:>12.0f} ns; p90: {:>12.0f} ns", name, result.median, result.p10, result.p90);
+    m_results.push_back(result);
+}
+
+void BenchSuite::save_json(const std::string& path) const {
+    json json_results = json::array();
+    for(const BenchResult& result: m_results)
+        json_results.push_back({{"name", result.name},
+                                {"repetitions", result.repetitions},
+                                {"calls_per_repetition", result.calls_per_repetition},
+                                {"median_ns", result.median},
+                                {"p10_ns", result.p10},
+                                {"p90_ns", result.p90},
+                                {"min_ns", result.min},
+                                {"mean_ns", result.mean}});
+    std::ofstream file(path);
+    if(!file)
+        raise_critical("Can't open benchmark output file '{}'!", path);
+    file << json {{"benchmarks", json_results}}.dump(4) << std::endl;
+}
+
+std::vector<BenchResult> load_json_results(const std::string& path) {
+    std::ifstream file(path);
+    if(!file)
+        raise_critical("Can't open benchmark results '{}'!", path);
+    json json_file;
+    try {
+        file >> json_file;
+    } catch(const json::exception& e) {
+        raise_critical("Benchmark results '{}' are corrupt: {}", path, e.what());
+    }
+
+    std::vector<BenchResult> results;
+    for(const json& json_result: json_file["benchmarks"]) {
+        BenchResult result;
+        result.name                 = json_result["name"].get<std::string>();
+        result.repetitions          = json_result["repetitions"].get<size_t>();
+        result.calls_per_repetition = json_result["calls_per_repetition"].get<size_t>();
+        result.median               = json_result["median_ns"].get<double>();
+        result.p10                  = json_result["p10_ns"].get<double>();
+        result.p90                  = json_result["p90_ns"].get<double>();
+        result.min                  = json_result["min_ns"].get<double>();
+        result.mean                 = json_result["mean_ns"].get<double>();
+        results.push_back(result);
+    }
+    return results;
+}
+
+size_t compare(const std::vector<BenchResult>& baseline, const std::vector<BenchResult>& current, double threshold) {
+    std::unordered_map<std::string, const BenchResult*> baseline_by_name;
+    for(const BenchResult& result: baseline)
+        baseline_by_name[result.name] = &result;
+
+    size_t regressions = 0;
+    for(const BenchResult& result: current) {
+        auto it = baseline_by_name.find(result.name);
+        if(it == baseline_by_name.end()) {
+            log_client_general("{:<50} new", result.name);
+            continue;
+        }
+        double ratio = result.median / it->second->median;
+        if(ratio > 1.0 + threshold) {
+            ++regressions;
+            log_client_warn("{:<50} {:>12.0f} ns -> {:>12.0f} ns; {:.2f}x slower", result.name, it->second->median, result.median, ratio);
+        } else if(ratio < 1.0 / (1.0 + threshold))
+            log_client_general("{:<50} {:>12.0f} ns -> {:>12.0f} ns; {:.2f}x faster", result.name, it->second->median, result.median, 1.0 / ratio);
+        else
+            log_client_extra("{:<50} {:>12.0f} ns -> {:>12.0f} ns; unchanged", result.name, it->second->median, result.median);
+    }
+    log_client_general("{} regressions of more than {}%", regressions, threshold * 100.0);
+    return regressions;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <vector>
+
+// timings of one benchmark in nanoseconds per call
+struct BenchResult {
+    std::string name;
+    size_t      repetitions          = 0;
+    size_t      calls_per_repetition = 0;
+    double      median               = 0.0;
+    double      p10                  = 0.0;
+    double      p90                  = 0.0;
+    double      min                  = 0.0;
+    double      mean                 = 0.0;
+};
+
+struct BenchConfig {
+    // untimed repetitions before measuring
+    size_t warmup_repetitions = 3;
+    size_t repetitions        = 15;
+    // each repetition calls the function until at least this much time passed
+    double min_repetition_seconds = 0.01;
+    // only run benchmarks whose name contains this
+    std::string filter;
+};
+
+// runs benchmarks one after another and collects their results
+class BenchSuite {
+private:
+    BenchConfig              m_config;
+    std::vector<BenchResult> m_results;
+
+public:
+    explicit BenchSuite(const BenchConfig& config)
+        : m_config(config) {}
+
+    // skipped when name doesn't match filter
+    void run(const std::string& name, const std::function<void()>& func);
+
+    const std::vector<BenchResult>& results() const { return m_results; }
+    void                            save_json(const std::string& path) const;
+};
+
+std::vector<BenchResult> load_json_results(const std::string& path);
+
+// log median of each benchmark in both files
+// regression when current median is more than threshold slower than baseline
+// return amount of regressions
+size_t compare(const std::vector<BenchResult>& baseline, const std::vector<BenchResult>& current, double threshold);
+
+// keep compiler from optimizing results away
+void do_not_optimize(float value);
@@ -0,0 +1,171 @@
+#include "bench.h"
+#include "neural_net.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// random classification data
+// input: uniform in [0; 1], output: one hot
+NeuralNet::Data random_data(size_t x_size, size_t y_size, size_t n) {
+    arma::fmat raw(x_size + y_size, n, arma::fill::zeros);
+    raw.rows(0, x_size - 1).randu();
+    for(size_t i = 0; i < n; ++i)
+        raw(x_size + std::rand() % y_size, i) = 1.0f;
+    return {raw, x_size, y_size};
+}
+
+std::string sizes_str(const std::vector<size_t>& sizes) {
+    std::string str;
+    for(size_t size: sizes)
+        str += (str.empty() ? "" : "-") + std::to_string(size);
+    return str;
+}
+
+// kernels of one topology with one mini batch size
+void bench_batch(BenchSuite& suite, NeuralNet::Network& net, const NeuralNet::Data& data, size_t batch_size) {
+    std::string                prefix = sizes_str(net.sizes) + "/batch_" + std::to_string(batch_size) + "/";
+    const arma::subview<float> x      = data.get_mini_x(0, batch_size);
+    const arma::subview<float> y      = data.get_mini_y(0, batch_size);
+
+    suite.run(prefix + "feedforward", [&]() {
+        do_not_optimize(NeuralNet::feedforward(net, x)(0));
+    });
+    // magnitude pruned copy on the sparse path
+    NeuralNet::Network pruned = net;
+    NeuralNet::prune_magnitude(pruned, 0.9f);
+    NeuralNet::SparseNetwork sparse = NeuralNet::to_sparse(pruned, 0.0f);
+    arma::fmat               x_mat  = x;
+    suite.run(prefix + "sparse_feedforward_90", [&]() {
+        do_not_optimize(NeuralNet::feedforward(sparse, x_mat)(0));
+    });
+
+    NeuralNet::HyperParameter hy;
+    hy.training_data = &data;
+    hy.init_eta      = 0.1f;
+    hy.mu            = 0.5f;
+    hy.lambda_l2     = 0.1f;
+    NeuralNet::TrainingWorkspace workspace(net, hy);
+    suite.run(prefix + "backprop", [&]() {
+        NeuralNet::backprop(net, x, y, workspace.nabla.biases, workspace.nabla.weights);
+        do_not_optimize(workspace.nabla.flat(0));
+    });
+    // tiny eta <- weights stay in a realistic range
+    suite.run(prefix + "update_mini_batch", [&]() {
+        NeuralNet::update_mini_batch(net, x, y, workspace, hy, 1e-6f, data.get_x().n_cols);
+        do_not_optimize(net.flat(0));
+    });
+
+    // widest layer
+    size_t     width = *std::max_element(net.sizes.begin() + 1, net.sizes.end());
+    arma::fmat z(width, batch_size, arma::fill::randn);
+    suite.run(prefix + "sigmoid", [&]() {
+        do_not_optimize(NeuralNet::sigmoid(z)(0));
+    });
+    suite.run(prefix + "sigmoid_prime", [&]() {
+        do_not_optimize(NeuralNet::sigmoid_prime(z)(0));
+    });
+
+    // output layer
+    arma::fmat a       = NeuralNet::feedforward(net, x);
+    arma::fmat y_batch = y;
+    arma::fmat z_out(a.n_rows, batch_size, arma::fill::randn);
+    for(const char* cost_name: {"quadratic", "cross_entropy"}) {
+        std::shared_ptr<NeuralNet::Cost> cost = NeuralNet::Cost::get(cost_name);
+        suite.run(prefix + cost_name + "_fn", [&]() {
+            float sum = 0.0f;
+            for(size_t i = 0; i < batch_size; ++i)
+                sum += cost->fn(a.col(i), y_batch.col(i));
+            do_not_optimize(sum);
+        });
+        suite.run(prefix + cost_name + "_error", [&]() {
+            do_not_optimize(cost->error(z_out, a, y_batch)(0));
+        });
+    }
+}
+
+// kernels independent of mini batch size
+void bench_net(BenchSuite& suite, const std::vector<size_t>& sizes, const std::vector<size_t>& batch_sizes, size_t n) {
+    std::string     prefix = sizes_str(sizes) + "/";
+    NeuralNet::Data data   = random_data(sizes.front(), sizes.back(), n);
+
+    NeuralNet::Network net;
+    create_network(net, sizes);
+    for(size_t batch_size: batch_sizes)
+        bench_batch(suite, net, data, batch_size);
+
+    suite.run(prefix + "get_shuffled_" + std::to_string(n), [&]() {
+        do_not_optimize(data.get_shuffled().get_x_ptr(0)[0]);
+    });
+
+    // loaders
+    std::string json_path   = "neural_net_bench_net.json";
+    std::string binary_path = "neural_net_bench_net.bin";
+    NeuralNet::save_json(net, json_path);
+    NeuralNet::save_binary(net, binary_path);
+    NeuralNet::Network loaded;
+    suite.run(prefix + "load_json_network", [&]() {
+        NeuralNet::load_json_network(loaded, json_path);
+        do_not_optimize(loaded.flat(0));
+    });
+    suite.run(prefix + "load_binary_network", [&]() {
+        NeuralNet::load_binary_network(loaded, binary_path);
+        do_not_optimize(loaded.flat(0));
+    });
+    std::remove(json_path.c_str());
+    std::remove(binary_path.c_str());
+}
+
+int main(int argc, char* argv[]) {
+    NeuralNet::init();
+    NeuralNet::Log::set_client_level(NeuralNet::LogLevel::General);
+    NeuralNet::Log::set_learn_level(NeuralNet::LogLevel::Warn);
+
+    // neural_net_bench --compare baseline.json current.json [threshold]
+    if(argc > 1 && std::string(argv[1]) == "--compare") {
+        if(argc < 4)
+            raise_critical("Please specify the baseline and current result files.");
+        double threshold = argc > 4 ? std::stod(argv[4]) : 0.1;
+        return compare(load_json_results(argv[2]), load_json_results(argv[3]), threshold) ? 1 : 0;
+    }
+
+    // neural_net_bench [output.json] [--filter name] [--repetitions n] [--quick]
+    std::string output_path = "neural_net_bench.json";
+    BenchConfig config;
+    bool        quick = false;
+    for(int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if(arg == "--filter" && i + 1 < argc)
+            config.filter = argv[++i];
+        else if(arg == "--repetitions" && i + 1 < argc) {
+            // percentiles need at least one sample
+            long repetitions = std::stol(argv[++i]);
+            if(repetitions < 1)
+                raise_critical("--repetitions has to be at least 1.");
+            config.repetitions = repetitions;
+        }
+        else if(arg == "--quick")
+            quick = true;
+        else
+            output_path = arg;
+    }
+    if(quick) {
+        config.warmup_repetitions     = 1;
+        config.repetitions            = 5;
+        config.min_repetition_seconds = 0.002;
+    }
+
+    // football sized up to wide mnist nets
+    std::vector<std::vector<size_t>> topologies  = {{3, 100, 100, 12}, {784, 30, 10}, {784, 100, 10}, {784, 800, 800, 10}};
+    std::vector<size_t>              batch_sizes = {1, 10, 50, 200};
+    if(quick)
+        topologies.pop_back();
+
+    BenchSuite suite(config);
+    for(const std::vector<size_t>& sizes: topologies)
+        bench_net(suite, sizes, batch_sizes, 10000);
+    suite.save_json(output_path);
+    log_client_general("Wrote {} results to '{}'", suite.results().size(), output_path);
+    return 0;
+}
@@ -0,0 +1,186 @@
+#include "neural_net.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <string>
+
+using json = nlohmann::json;
+
+// end-to-end benchmark on synthetic data
+// time_to_accuracy <mnist|football> [--n training sets] [--target accuracy] [--max-epochs n] [--eta x]
+//                  [--mini-batch-size n] [--mu x] [--lambda-l2 x] [--optimizer momentum|nesterov|rmsprop|adam|adamw]
+//                  [--async] [--output results.json]
+//                  [--workers n] [--ring-address tcp:<port>|unix:<path>] [--fp16]
+int main(int argc, char* argv[]) {
+    // workers log into their own file
+    NeuralNet::LogConfig log_config;
+    if(const char* rank = std::getenv("NEURAL_NET_RANK")) {
+        log_config.console   = false;
+        log_config.file_path = std::string("neural_net_rank") + rank + ".log";
+    }
+    NeuralNet::Log::init(log_config);
+    NeuralNet::Log::set_client_level(NeuralNet::LogLevel::Extra);
+    NeuralNet::Log::set_learn_level(NeuralNet::LogLevel::General);
+    if(argc < 2)
+        raise_critical("Please specify the shape of the data: mnist or football.");
+    std::string shape = argv[1];
+    if(shape != "mnist" && shape != "football")
+        raise_critical("Unknown data shape '{}'.", shape);
+    bool mnist = shape == "mnist";
+
+    size_t      n            = mnist ? 50000 : 100000;
+    std::string output_path  = "time_to_accuracy.json";
+    size_t      workers      = 1;
+    std::string ring_address = "tcp:29500";
+
+    // defaults for each shape
+    NeuralNet::HyperParameter hy;
+    hy.target_accuracy = mnist ? 0.95f : 0.12f;
+    hy.max_epochs      = 30;
+    hy.init_eta        = 0.5f;
+    hy.mini_batch_size = mnist ? 10 : 30;
+    hy.mu              = mnist ? 0.0f : 0.2f;
+    hy.lambda_l2       = mnist ? 5.0f : 0.1f;
+
+    for(int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if(arg == "--async")
+            hy.async_monitoring = true;
+        else if(arg == "--fp16")
+            hy.fp16_gradients = true;
+        else if(i + 1 == argc)
+            raise_critical("Missing value of '{}'.", arg);
+        else if(arg == "--n")
+            n = std::stoul(argv[++i]);
+        else if(arg == "--target")
+            hy.target_accuracy = std::stof(argv[++i]);
+        else if(arg == "--max-epochs")
+            hy.max_epochs = std::stoul(argv[++i]);
+        else if(arg == "--eta")
+            hy.init_eta = std::stof(argv[++i]);
+        else if(arg == "--mini-batch-size")
+            hy.mini_batch_size = std::stoul(argv[++i]);
+        else if(arg == "--mu")
+            hy.mu = std::stof(argv[++i]);
+        else if(arg == "--lambda-l2")
+            hy.lambda_l2 = std::stof(argv[++i]);
+        else if(arg == "--output")
+            output_path = argv[++i];
+        else if(arg == "--workers")
+            workers = std::stoul(argv[++i]);
+        else if(arg == "--ring-address")
+            ring_address = argv[++i];
+        else if(arg == "--optimizer") {
+            std::string optimizer = argv[++i];
+            if(optimizer == "momentum")
+                hy.optimizer_type = NeuralNet::OptimizerType::Momentum;
+            else if(optimizer == "nesterov")
+                hy.optimizer_type = NeuralNet::OptimizerType::Nesterov;
+            else if(optimizer == "rmsprop")
+                hy.optimizer_type = NeuralNet::OptimizerType::RMSProp;
+            else if(optimizer == "adam")
+                hy.optimizer_type = NeuralNet::OptimizerType::Adam;
+            else if(optimizer == "adamw")
+                hy.optimizer_type = NeuralNet::OptimizerType::AdamW;
+            else
+                raise_critical("Unknown optimizer '{}'.", optimizer);
+        } else
+            raise_critical("Unknown argument '{}'.", arg);
+    }
+
+    // processes share the cores
+    NeuralNet::ThreadingPolicy threading_policy;
+    threading_policy.cores = std::max<size_t>(1, NeuralNet::Threading::available_cores() / workers);
+    NeuralNet::Threading::init(threading_policy);
+    // same arguments in all workers <- same data and hyper parameters
+    std::vector<int>                             worker_pids  = NeuralNet::launch_local_workers(argv, workers, ring_address);
+    std::unique_ptr<NeuralNet::RingCommunicator> communicator = NeuralNet::RingCommunicator::from_env();
+
+    //////////
+    // data //
+    //////////
+    auto            begin         = std::chrono::high_resolution_clock::now();
+    size_t          n_eval        = std::max<size_t>(1, n / 5);
+    NeuralNet::Data training_data = mnist ? NeuralNet::synthetic_mnist(n, 1) : NeuralNet::synthetic_football(n, 1);
+    // different seed <- no duplicates of training data
+    NeuralNet::Data eval_data     = mnist ? NeuralNet::synthetic_mnist(n_eval, 2) : NeuralNet::synthetic_football(n_eval, 2);
+    float           data_time     = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - begin).count();
+    // every rank trains on its part
+    if(communicator)
+        training_data = training_data.get_shard(communicator->get_rank(), communicator->get_world_size());
+    log_client_general("Generated {} training and {} evaluation data sets in {} s", n, n_eval, data_time);
+
+    NeuralNet::Network net;
+    if(mnist)
+        create_network(net, {784, 100, 10});
+    else {
+        create_network(net, {3, 100, 100, 12});
+        // both home and guest goals have to be correct
+        net.evaluator = [](const arma::fvec& y, const arma::fvec& a) {
+            return NeuralNet::DefaultEvaluater::classifier(y.rows(0, 5), a.rows(0, 5)) &&
+                   NeuralNet::DefaultEvaluater::classifier(y.rows(6, 11), a.rows(6, 11));
+        };
+    }
+
+    //////////////
+    // training //
+    //////////////
+    hy.training_data         = &training_data;
+    hy.eval_data             = &eval_data;
+    hy.monitor_eval_accuracy = true;
+    hy.stop_at_target        = true;
+    hy.communicator          = communicator.get();
+    NeuralNet::sgd(net, hy);
+    // only rank 0 reports
+    if(communicator && communicator->get_rank())
+        return 0;
+
+    size_t epochs          = hy.eval_accuracies.size();
+    float  learn_seconds   = hy.learn_time / 1e9f;
+    float  epoch_seconds   = epochs ? learn_seconds / epochs : 0.0f;
+    float  samples_per_sec = learn_seconds ? n * epochs / learn_seconds : 0.0f;
+    float  target_seconds  = hy.time_to_target / 1e9f;
+    float  final_accuracy  = epochs ? hy.eval_accuracies.back() : 0.0f;
+    size_t peak_rss        = NeuralNet::peak_rss();
+    bool   reached_target  = hy.epochs_to_target != 0;
+    float  wall_seconds    = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - begin).count();
+
+    log_client_general("{} epochs on {} data sets of shape {}:", epochs, n, shape);
+    log_client_general("\tepoch time: {} s", epoch_seconds);
+    log_client_general("\tsamples/sec: {}", samples_per_sec);
+    log_client_general("\tpeak rss: {} MiB", peak_rss / (1024.0f * 1024.0f));
+    if(reached_target)
+        log_client_general("\treached eval accuracy {} after {} epochs in {} s", hy.target_accuracy, hy.epochs_to_target, target_seconds);
+    else
+        log_client_warn("\tdidn't reach eval accuracy {}; final accuracy: {}", hy.target_accuracy, final_accuracy);
+
+    json results = {{"shape", shape},
+                    {"n", n},
+                    {"mini_batch_size", hy.mini_batch_size},
+                    {"init_eta", hy.init_eta},
+                    {"optimizer_type", static_cast<int>(hy.optimizer_type)},
+                    {"async_monitoring", hy.async_monitoring},
+                    {"workers", workers},
+                    {"fp16_gradients", hy.fp16_gradients},
+                    {"target_accuracy", hy.target_accuracy},
+                    {"reached_target", reached_target},
+                    {"epochs_to_target", hy.epochs_to_target},
+                    {"time_to_target_s", target_seconds},
+                    {"epochs", epochs},
+                    {"epoch_time_s", epoch_seconds},
+                    {"samples_per_sec", samples_per_sec},
+                    {"final_eval_accuracy", final_accuracy},
+                    {"peak_rss_bytes", peak_rss},
+                    {"data_time_s", data_time},
+                    {"wall_time_s", wall_seconds}};
+    std::ofstream file(output_path);
+    if(!file)
+        raise_critical("Can't open output file '{}'!", output_path);
+    file << results.dump(4) << std::endl;
+    if(!NeuralNet::wait_for_workers(worker_pids))
+        return 1;
+    return reached_target ? 0 : 1;
+}